@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// Home of the audio buffers of every instance in the process
+//
+// On 64-bit Linux, blocks are carved out of one large mapping that is
+// reserved up front and only backed by memory as it is used. Sizes are
+// rounded up to whole pages. A freed block hands its memory back to the
+// system and waits on a list for the next instance that needs the same size.
+// A 32-bit host has no address space to spare for that, so there, and once
+// the reserved mapping is used up, every block is a mapping of its own.
+// Other systems take blocks from the C heap. Either way a block starts out
+// zeroed and aligned to a cache line.
+//
+// Nothing here is real-time safe. Allocate from the constructor,
+// sampleRateChanged() or activate(), and prefault() from activate(), so the
+// first touch of every page happens there instead of in run().
+//
+// Usage is kept per owner, the name of the plugin core that holds a block.
+// The plugins are built with hidden symbols, so every plugin binary that a
+// host loads has an arena of its own.
+class Arena {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    struct Usage {
+        size_t bytes;
+        size_t locked;
+        uint32_t blocks;
+    };
+
+    // Never destroyed: static objects holding blocks may release them at
+    // any point during exit, and the system takes the memory back after
+    static Arena& get() {
+        static Arena* arena = new Arena();
+        return *arena;
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // At least the given number of bytes, all zero
+    void* allocate(size_t bytes, const char* owner) {
+        size_t size(roundUp(std::max(bytes, (size_t) 1), PAGE));
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        char* p(nullptr);
+        void* base(nullptr);
+        std::vector<char*>& sameSize(spare[size]);
+        if (!sameSize.empty()) {
+            p = sameSize.back();
+            sameSize.pop_back();
+        } else if (region != nullptr) {
+            // Big blocks start on a huge page boundary
+            size_t start(roundUp(used, size >= HUGE_PAGE ? HUGE_PAGE : PAGE));
+            if (start + size <= RESERVED) {
+                p = region + start;
+                used = start + size;
+            }
+        }
+
+        bool mapped(false);
+        if (p == nullptr) {
+            p = mapBlock(size);
+            mapped = p != nullptr;
+        }
+        if (p == nullptr) {
+            base = std::calloc(size + ALIGNMENT, 1);
+            if (base == nullptr) {
+                throw std::bad_alloc();
+            }
+            p = (char*) roundUp((uintptr_t) base, ALIGNMENT);
+        }
+
+        blocks[p] = Block { size, owner, base, mapped, false };
+        Usage& u(owners[owner]);
+        u.bytes += size;
+        ++u.blocks;
+        return p;
+    }
+
+    void release(void* p) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it(blocks.find(p));
+        if (it == blocks.end()) {
+            return;
+        }
+        Block b(it->second);
+        blocks.erase(it);
+
+        Usage& u(owners[b.owner]);
+        u.bytes -= b.size;
+        --u.blocks;
+        if (b.locked) {
+            u.locked -= b.size;
+            unlockPages(p, b.size);
+        }
+
+        if (b.base != nullptr) {
+            std::free(b.base);
+            return;
+        }
+        if (b.mapped) {
+            unmapBlock(p, b.size);
+            return;
+        }
+
+        // The pages read as zeros the next time they are touched
+#if defined(__linux__)
+        if (madvise(p, b.size, MADV_DONTNEED) != 0) {
+            std::memset(p, 0, b.size);
+        }
+#endif
+        spare[b.size].push_back((char*) p);
+    }
+
+    // Back every page of a block with memory, and keep it there if the
+    // process is allowed to lock memory
+    void prefault(void* p) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it(blocks.find(p));
+        if (it == blocks.end() || it->second.locked) {
+            return;
+        }
+        Block& b(it->second);
+
+        if (lockPages(p, b.size)) {
+            b.locked = true;
+            owners[b.owner].locked += b.size;
+        } else {
+            populate(p, b.size);
+        }
+    }
+
+    // Current usage of each owner that has held memory
+    std::map<std::string, Usage> usage() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return owners;
+    }
+
+private:
+    struct Block {
+        size_t size;
+        const char* owner;
+        void* base;
+        bool mapped;
+        bool locked;
+    };
+
+    static constexpr size_t PAGE = 4096;
+    static constexpr size_t HUGE_PAGE = 2 << 20;
+
+    // Address space only: 16 GiB on 64-bit targets, none otherwise
+    static constexpr size_t RESERVED = sizeof(void*) >= 8 ? (size_t) 16 << 30 : 0;
+
+    Arena() : region(nullptr), used(0) {
+#if defined(__linux__)
+        void* p(RESERVED != 0 ? mmap(nullptr, RESERVED + HUGE_PAGE, PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+                              : MAP_FAILED);
+        if (p != MAP_FAILED) {
+            region = (char*) roundUp((uintptr_t) p, HUGE_PAGE);
+#if defined(BITROT_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+            madvise(region, RESERVED, MADV_HUGEPAGE);
+#endif
+        }
+#endif
+    }
+
+    static size_t roundUp(size_t x, size_t alignment) {
+        return (x + alignment - 1) / alignment * alignment;
+    }
+
+    static char* mapBlock(size_t size) {
+#if defined(__linux__)
+        void* p(mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (p == MAP_FAILED) {
+            return nullptr;
+        }
+#if defined(BITROT_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+        madvise(p, size, MADV_HUGEPAGE);
+#endif
+        return (char*) p;
+#else
+        (void) size;
+        return nullptr;
+#endif
+    }
+
+    static void unmapBlock(void* p, size_t size) {
+#if defined(__linux__)
+        munmap(p, size);
+#else
+        (void) p;
+        (void) size;
+#endif
+    }
+
+    static bool lockPages(void* p, size_t size) {
+#if defined(__linux__)
+        return mlock(p, size) == 0;
+#else
+        (void) p;
+        (void) size;
+        return false;
+#endif
+    }
+
+    static void unlockPages(void* p, size_t size) {
+#if defined(__linux__)
+        munlock(p, size);
+#else
+        (void) p;
+        (void) size;
+#endif
+    }
+
+    static void populate(void* p, size_t size) {
+#if defined(__linux__) && defined(MADV_POPULATE_WRITE)
+        if (madvise(p, size, MADV_POPULATE_WRITE) == 0) {
+            return;
+        }
+#endif
+        volatile char* bytes((char*) p);
+        for (size_t i = 0; i < size; i += PAGE) {
+            bytes[i] = bytes[i];
+        }
+    }
+
+    mutable std::mutex mutex;
+
+    char* region;
+    size_t used;
+
+    std::map<size_t, std::vector<char*>> spare;
+    std::map<void*, Block> blocks;
+    std::map<std::string, Usage> owners;
+};
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DistrhoPlugin.hpp"
+#include "src/DistrhoPluginInternal.hpp"
+#include "DistrhoPluginInfo.h"
+#include "Json.hpp"
+
+
+START_NAMESPACE_DISTRHO
+Plugin* createPlugin();
+END_NAMESPACE_DISTRHO
+
+
+struct Scenario {
+    const char* label;
+    const char* name;
+    const char* state;
+};
+
+
+// Parameter states worth measuring, as comma separated symbol=value pairs.
+// Plugins without an entry here are measured with their default state.
+static const Scenario scenarios[] = {
+    { "crush", "ds1", "downsample=1,distort=0.5,prenoise=0.5" },
+    { "crush", "ds16", "downsample=16,distort=0.5,prenoise=0.5" },
+    { "crush", "ds16+post", "downsample=16,distort=0.5,prenoise=0.5,postnoise=0.5" },
+    { "repeat", "bypass", "active=0" },
+    { "repeat", "active", "active=1" },
+    { "repeat", "varispeed", "active=1,varispeed=1,speed=0.5" },
+    { "reverser", "bypass", "active=0" },
+    { "reverser", "active", "active=1" },
+    { "tapestop", "bypass", "active=0" },
+    { "tapestop", "stop", "active=1" },
+    { "rack", "bypass", "" },
+    { "rack", "chain", "crush_active=1,crush_downsample=16,crush_distort=0.5,"
+                       "repeat_active=1,reverser_active=1,tapestop_active=1" },
+};
+
+static const double sampleRates[] = { 44100.0, 48000.0, 96000.0, 192000.0 };
+static const uint32_t blockSizes[] = { 32, 256, 1024 };
+
+static const double SECONDS = 10.0;
+
+// Every state is measured with full scale noise, with a tail and with
+// digital silence. The tail is the same noise fading from -60 dB down
+// through the subnormal range over SECONDS; without denormal protection its
+// slowest block stands out. Silence shows what an idle instance costs.
+enum Input { NOISE, TAIL, SILENCE };
+
+static const char* inputNames[] = { "noise", "tail", "silence" };
+
+static const double TAIL_START = 1e-3;
+static const double TAIL_END = 1e-45;
+
+
+static void applyState(PluginExporter& plugin, const char* state) {
+    std::string s(state);
+    size_t pos = 0;
+
+    while (pos < s.size()) {
+        size_t end = s.find(',', pos);
+        if (end == std::string::npos) {
+            end = s.size();
+        }
+
+        std::string pair(s.substr(pos, end - pos));
+        size_t eq = pair.find('=');
+        std::string symbol(pair.substr(0, eq));
+        float value = std::atof(pair.substr(eq + 1).c_str());
+
+        for (uint32_t i = 0; i < plugin.getParameterCount(); ++i) {
+            if (symbol == plugin.getParameterSymbol(i).buffer()) {
+                plugin.setParameterValue(i, value);
+            }
+        }
+
+        pos = end + 1;
+    }
+}
+
+
+// Run SECONDS of audio through a fresh instance. Every block is timed on
+// its own so the worst one can be reported next to the average.
+static void measure(Array& results, const Scenario& scenario, Input signal,
+                    double rate, uint32_t blockSize) {
+    d_lastBufferSize = blockSize;
+    d_lastSampleRate = rate;
+
+    PluginExporter plugin;
+    applyState(plugin, scenario.state);
+    plugin.activate();
+
+    std::vector<float> noise(DISTRHO_PLUGIN_NUM_INPUTS * blockSize);
+    std::vector<float> input(DISTRHO_PLUGIN_NUM_INPUTS * blockSize);
+    std::vector<float> output(DISTRHO_PLUGIN_NUM_OUTPUTS * blockSize);
+
+    uint32_t seed = 1;
+    for (size_t i = 0; i < noise.size(); ++i) {
+        seed = seed * 1664525 + 1013904223;
+        noise[i] = (seed / (float) 0xffffffff) - 0.5f;
+    }
+    if (signal == SILENCE) {
+        std::fill(input.begin(), input.end(), 0.f);
+    } else {
+        input = noise;
+    }
+
+    const float* inputs[DISTRHO_PLUGIN_NUM_INPUTS];
+    float* outputs[DISTRHO_PLUGIN_NUM_OUTPUTS];
+    for (uint32_t c = 0; c < DISTRHO_PLUGIN_NUM_INPUTS; ++c) {
+        inputs[c] = &input[c * blockSize];
+    }
+    for (uint32_t c = 0; c < DISTRHO_PLUGIN_NUM_OUTPUTS; ++c) {
+        outputs[c] = &output[c * blockSize];
+    }
+
+    uint32_t blocks = (uint32_t) (SECONDS * rate / blockSize);
+    double total = 0.0;
+    double worst = 0.0;
+
+    double level = TAIL_START;
+    double fade = std::pow(TAIL_END / TAIL_START, 1.0 / blocks);
+
+    for (uint32_t b = 0; b < blocks; ++b) {
+        if (signal == TAIL) {
+            for (size_t i = 0; i < input.size(); ++i) {
+                input[i] = noise[i] * (float) level;
+            }
+            level *= fade;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        plugin.run(inputs, outputs, blockSize);
+        auto end = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        total += ns;
+        worst = std::max(worst, ns);
+    }
+
+    double frames = (double) blocks * blockSize;
+    double audio = frames / rate * 1e9;
+
+    Object result;
+    result.item("scenario", Syntax().string(scenario.name));
+    result.item("state", Syntax().string(scenario.state));
+    result.item("input", Syntax().string(inputNames[signal]));
+    result.item("rate", Syntax().number(rate));
+    result.item("block_size", Syntax().number(blockSize));
+    result.item("ns_per_frame", Syntax().number(total / frames));
+    result.item("ns_per_block", Syntax().number(total / blocks));
+    result.item("worst_block_ns", Syntax().number(worst));
+    result.item("deadline_ns", Syntax().number(blockSize / rate * 1e9));
+    result.item("realtime", Syntax().number(audio / total));
+    results.item(Syntax().object(result));
+}
+
+
+int main() {
+    std::setlocale(LC_ALL, "C");
+
+    d_lastBufferSize = 256;
+    d_lastSampleRate = 44100.0;
+
+    std::string label;
+    {
+        PluginExporter plugin;
+        label = plugin.getLabel();
+    }
+
+    std::vector<Scenario> selected;
+    for (const Scenario& scenario : scenarios) {
+        if (label == scenario.label) {
+            selected.push_back(scenario);
+        }
+    }
+    if (selected.empty()) {
+        selected.push_back(Scenario { label.c_str(), "default", "" });
+    }
+
+    Array results;
+    for (const Scenario& scenario : selected) {
+        for (double rate : sampleRates) {
+            for (uint32_t blockSize : blockSizes) {
+                measure(results, scenario, NOISE, rate, blockSize);
+                measure(results, scenario, TAIL, rate, blockSize);
+                measure(results, scenario, SILENCE, rate, blockSize);
+            }
+        }
+    }
+
+    Object obj;
+    obj.item("plugin", Syntax().string(label));
+    obj.item("seconds", Syntax().number(SECONDS));
+    obj.item("results", Syntax().array(results));
+
+    Syntax().object(obj).output();
+    std::cout << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+// Counter-based white noise generator
+//
+// Every value is a hash of its position in the stream, so there is no serial
+// dependency between samples and fill() vectorizes. The stream only depends
+// on the seed and on how many values have been drawn since reset(), which
+// keeps offline renders reproducible.
+class BlockNoise {
+public:
+    explicit BlockNoise(uint32_t seed = 1) : seed(seed), counter(0) {}
+
+    void reset() {
+        counter = 0;
+    }
+
+    // Uniformly distributed values in [0, 1)
+    void fill(float* out, uint32_t n) {
+        uint32_t base(counter + seed * 0x9e3779b9u);
+        for (uint32_t i = 0; i < n; ++i) {
+            out[i] = (hash(base + i) >> 8) * (1.f / 16777216.f);
+        }
+        counter += n;
+    }
+
+    // Move on as if fill() had drawn n values
+    void skip(uint32_t n) {
+        counter += n;
+    }
+
+private:
+    uint32_t seed;
+    uint32_t counter;
+
+    // lowbias32 by Chris Wellons
+    //
+    // https://nullprogram.com/blog/2018/07/31/
+    static uint32_t hash(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+};
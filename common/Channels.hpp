@@ -0,0 +1,30 @@
+#pragma once
+
+// Channel layout of the plugin being built
+//
+// Every plugin is built once per layout. The stereo builds keep their
+// original names, URIs and ids; the other layouts add a suffix to each so
+// hosts can tell them apart.
+
+#ifndef BITROT_CHANNELS
+    #define BITROT_CHANNELS 2
+#endif
+
+#if BITROT_CHANNELS == 1
+    #define BITROT_CHANNEL_NAME " (Mono)"
+    #define BITROT_CHANNEL_SUFFIX "_mono"
+#elif BITROT_CHANNELS == 2
+    #define BITROT_CHANNEL_NAME ""
+    #define BITROT_CHANNEL_SUFFIX ""
+#elif BITROT_CHANNELS == 6
+    #define BITROT_CHANNEL_NAME " (6 channels)"
+    #define BITROT_CHANNEL_SUFFIX "_6ch"
+#elif BITROT_CHANNELS == 8
+    #define BITROT_CHANNEL_NAME " (8 channels)"
+    #define BITROT_CHANNEL_SUFFIX "_8ch"
+#else
+    #error "BITROT_CHANNELS must be 1, 2, 6 or 8"
+#endif
+
+#define BITROT_UNIQUE_ID(ID) \
+    ((ID) + (BITROT_CHANNELS == 2 ? 0 : BITROT_CHANNELS * 1000))
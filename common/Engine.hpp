@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DistrhoPlugin.hpp"
+#include "src/DistrhoPluginInternal.hpp"
+#include "DistrhoPluginInfo.h"
+
+
+// Many independent instances of the plugin rendered over the same timeline
+//
+// Every render() call runs each stem through the next stretch of frames,
+// one task per stem. The stems are dealt out to per thread queues; a thread
+// works through its own queue from the front and, once it runs dry, steals
+// from the back of the others. Claiming a task is one compare and swap, and
+// every thread renders into scratch buffers of its own that are allocated
+// up front. The only locks are taken to start and finish a render() call.
+class Engine {
+public:
+    static constexpr uint32_t INPUTS = DISTRHO_PLUGIN_NUM_INPUTS;
+    static constexpr uint32_t OUTPUTS = DISTRHO_PLUGIN_NUM_OUTPUTS;
+
+    // Interleaved audio of one stem over the whole timeline. A null input
+    // renders from silence, a null output discards the result.
+    struct Stem {
+        const float* input;
+        float* output;
+    };
+
+    Engine(uint32_t stems, uint32_t threads, double rate, uint32_t blockSize)
+        : blockSize(blockSize),
+          stems(stems, Stem { nullptr, nullptr }),
+          queues(std::max(threads, 1u)),
+          workers(std::max(threads, 1u)),
+          position(0),
+          frames(0),
+          generation(0),
+          busy(0),
+          quit(false) {
+        d_lastBufferSize = blockSize;
+        d_lastSampleRate = rate;
+
+        for (uint32_t i = 0; i < stems; ++i) {
+            plugins.emplace_back(new PluginExporter());
+        }
+
+        for (Worker& w : workers) {
+            w.scratch.assign((INPUTS + OUTPUTS) * blockSize, 0.f);
+            for (uint32_t c = 0; c < INPUTS; ++c) {
+                w.inputs[c] = &w.scratch[c * blockSize];
+            }
+            for (uint32_t c = 0; c < OUTPUTS; ++c) {
+                w.outputs[c] = &w.scratch[(INPUTS + c) * blockSize];
+            }
+        }
+
+        // The calling thread does its share of the work as thread 0
+        for (uint32_t t = 1; t < workers.size(); ++t) {
+            pool.emplace_back(&Engine::loop, this, t);
+        }
+    }
+
+    Engine(const Engine&) = delete;
+
+    ~Engine() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : pool) {
+            t.join();
+        }
+    }
+
+    uint32_t size() const {
+        return plugins.size();
+    }
+
+    uint32_t threads() const {
+        return workers.size();
+    }
+
+    // Frames rendered so far
+    uint64_t rendered() const {
+        return position;
+    }
+
+    PluginExporter& plugin(uint32_t stem) {
+        return *plugins[stem];
+    }
+
+    void setStem(uint32_t stem, const float* input, float* output) {
+        stems[stem] = Stem { input, output };
+    }
+
+    void activate() {
+        for (auto& p : plugins) {
+            p->activate();
+        }
+        position = 0;
+    }
+
+    void deactivate() {
+        for (auto& p : plugins) {
+            p->deactivate();
+        }
+    }
+
+    // Render the next nframes of every stem and wait for all of them
+    void render(uint32_t nframes) {
+        frames = nframes;
+
+        uint32_t n(workers.size());
+        for (uint32_t t = 0; t < n; ++t) {
+            uint64_t head(uint64_t(size()) * t / n);
+            uint64_t tail(uint64_t(size()) * (t + 1) / n);
+            queues[t].range.store(head | (tail << 32), std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++generation;
+            busy = n - 1;
+        }
+        wake.notify_all();
+
+        work(0);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this] { return busy == 0; });
+        }
+
+        position += nframes;
+    }
+
+private:
+    // Stems [head, tail) still waiting in one thread's queue, packed into a
+    // single word so that both ends can be claimed with one compare and
+    // swap. Padded to keep every queue on a cache line of its own.
+    struct Queue {
+        std::atomic<uint64_t> range;
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
+
+        Queue() : range(0) {}
+    };
+
+    struct Worker {
+        std::vector<float> scratch;
+        float* inputs[INPUTS];
+        float* outputs[OUTPUTS];
+    };
+
+    uint32_t blockSize;
+
+    std::vector<std::unique_ptr<PluginExporter>> plugins;
+    std::vector<Stem> stems;
+    std::vector<Queue> queues;
+    std::vector<Worker> workers;
+    std::vector<std::thread> pool;
+
+    uint64_t position;
+    uint32_t frames;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation;
+    uint32_t busy;
+    bool quit;
+
+    // Claim the stem at the front of a queue, or at the back when stealing
+    static bool claim(Queue& q, bool back, uint32_t& stem) {
+        uint64_t r(q.range.load(std::memory_order_relaxed));
+        for (;;) {
+            uint32_t head((uint32_t) r);
+            uint32_t tail((uint32_t) (r >> 32));
+            if (head == tail) {
+                return false;
+            }
+
+            uint64_t next(back ? r - (uint64_t(1) << 32) : r + 1);
+            if (q.range.compare_exchange_weak(r, next, std::memory_order_acq_rel,
+                                              std::memory_order_relaxed)) {
+                stem = back ? tail - 1 : head;
+                return true;
+            }
+        }
+    }
+
+    void work(uint32_t self) {
+        uint32_t stem;
+        while (claim(queues[self], false, stem)) {
+            renderStem(stem, workers[self]);
+        }
+
+        // No new tasks appear during a render() call, so once every queue
+        // has been found empty this thread is done
+        uint32_t n(workers.size());
+        for (uint32_t i = 1; i < n; ++i) {
+            Queue& victim(queues[(self + i) % n]);
+            while (claim(victim, true, stem)) {
+                renderStem(stem, workers[self]);
+            }
+        }
+    }
+
+    void renderStem(uint32_t index, Worker& w) {
+        const Stem& stem(stems[index]);
+        PluginExporter& plugin(*plugins[index]);
+
+        for (uint32_t offset = 0; offset < frames; offset += blockSize) {
+            uint32_t n(std::min(blockSize, frames - offset));
+            uint64_t frame(position + offset);
+
+            if (stem.input != nullptr) {
+                const float* in(stem.input + frame * INPUTS);
+                for (uint32_t i = 0; i < n; ++i) {
+                    for (uint32_t c = 0; c < INPUTS; ++c) {
+                        w.inputs[c][i] = in[i * INPUTS + c];
+                    }
+                }
+            } else {
+                for (uint32_t c = 0; c < INPUTS; ++c) {
+                    std::memset(w.inputs[c], 0, sizeof(float) * n);
+                }
+            }
+
+            plugin.run((const float**) w.inputs, w.outputs, n);
+
+            if (stem.output != nullptr) {
+                float* out(stem.output + frame * OUTPUTS);
+                for (uint32_t i = 0; i < n; ++i) {
+                    for (uint32_t c = 0; c < OUTPUTS; ++c) {
+                        out[i * OUTPUTS + c] = w.outputs[c][i];
+                    }
+                }
+            }
+        }
+    }
+
+    void loop(uint32_t self) {
+        uint64_t seen(0);
+
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit) {
+                    return;
+                }
+                seen = generation;
+            }
+
+            work(self);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busy == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Engine.hpp"
+#include "Json.hpp"
+
+
+START_NAMESPACE_DISTRHO
+Plugin* createPlugin();
+END_NAMESPACE_DISTRHO
+
+
+static const char* USAGE =
+    "usage: %s [-n stems] [-t seconds] [-j threads] [-s symbol=value]...\n"
+    "\n"
+    "Renders the same timeline through many instances of the plugin with\n"
+    "1, 2, 4... threads up to the number of cores (or -j), and prints the\n"
+    "scaling as JSON, along with the buffer memory the instances hold.\n";
+
+static const double RATE = 48000.0;
+static const uint32_t BLOCK_SIZE = 256;
+
+// Frames handed to Engine::render() at a time
+static const uint32_t WINDOW = 4800;
+
+
+static bool applySetting(Engine& engine, const std::string& setting) {
+    size_t eq = setting.find('=');
+    if (eq == std::string::npos) {
+        return false;
+    }
+
+    std::string symbol(setting.substr(0, eq));
+    float value = std::atof(setting.substr(eq + 1).c_str());
+
+    PluginExporter& first(engine.plugin(0));
+    for (uint32_t i = 0; i < first.getParameterCount(); ++i) {
+        if (symbol == first.getParameterSymbol(i).buffer()) {
+            for (uint32_t s = 0; s < engine.size(); ++s) {
+                engine.plugin(s).setParameterValue(i, value);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+
+int main(int argc, char** argv) {
+    std::setlocale(LC_ALL, "C");
+
+    uint32_t stems = 64;
+    double seconds = 2.0;
+    uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<std::string> settings;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "-n" && i + 1 < argc) {
+            stems = std::atoi(argv[++i]);
+        } else if (arg == "-t" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            cores = std::atoi(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            settings.push_back(argv[++i]);
+        } else {
+            std::fprintf(stderr, USAGE, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (stems == 0 || seconds <= 0.0 || cores == 0) {
+        std::fprintf(stderr, USAGE, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t frames = (uint32_t) (seconds * RATE);
+
+    // One shared input, one output per stem
+    std::vector<float> input((size_t) frames * Engine::INPUTS);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < input.size(); ++i) {
+        seed = seed * 1664525 + 1013904223;
+        input[i] = (seed / (float) 0xffffffff) - 0.5f;
+    }
+    std::vector<float> output((size_t) stems * frames * Engine::OUTPUTS);
+
+    std::vector<uint32_t> counts;
+    for (uint32_t t = 1; t < cores; t *= 2) {
+        counts.push_back(t);
+    }
+    counts.push_back(cores);
+
+    std::string label;
+    Array results;
+    Object memory;
+    double single = 0.0;
+
+    for (uint32_t threads : counts) {
+        Engine engine(stems, threads, RATE, BLOCK_SIZE);
+        label = engine.plugin(0).getLabel();
+
+        for (const std::string& setting : settings) {
+            if (!applySetting(engine, setting)) {
+                std::fprintf(stderr, "unknown parameter setting '%s'\n", setting.c_str());
+                return EXIT_FAILURE;
+            }
+        }
+        for (uint32_t s = 0; s < stems; ++s) {
+            engine.setStem(s, input.data(), &output[(size_t) s * frames * Engine::OUTPUTS]);
+        }
+        engine.activate();
+
+        if (threads == counts.front()) {
+            for (const auto& owner : Arena::get().usage()) {
+                Object usage;
+                usage.item("bytes", Syntax().number(owner.second.bytes));
+                usage.item("locked_bytes", Syntax().number(owner.second.locked));
+                usage.item("blocks", Syntax().number(owner.second.blocks));
+                memory.item(owner.first, Syntax().object(usage));
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < frames; frame += WINDOW) {
+            engine.render(std::min(WINDOW, frames - frame));
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        engine.deactivate();
+
+        double wall = std::chrono::duration<double>(end - start).count();
+        if (threads == 1) {
+            single = wall;
+        }
+
+        Object result;
+        result.item("threads", Syntax().number(threads));
+        result.item("wall_seconds", Syntax().number(wall));
+        result.item("realtime", Syntax().number(stems * seconds / wall));
+        result.item("speedup", Syntax().number(single / wall));
+        result.item("efficiency", Syntax().number(single / wall / threads));
+        results.item(Syntax().object(result));
+    }
+
+    Object obj;
+    obj.item("plugin", Syntax().string(label));
+    obj.item("stems", Syntax().number(stems));
+    obj.item("seconds", Syntax().number(seconds));
+    obj.item("rate", Syntax().number(RATE));
+    obj.item("block_size", Syntax().number(BLOCK_SIZE));
+    obj.item("memory", Syntax().object(memory));
+    obj.item("results", Syntax().array(results));
+
+    Syntax().object(obj).output();
+    std::cout << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DistrhoPlugin.hpp"
+#include "src/DistrhoPluginInternal.hpp"
+#include "DistrhoPluginInfo.h"
+#include "Json.hpp"
+
+
+START_NAMESPACE_DISTRHO
+Plugin* createPlugin();
+END_NAMESPACE_DISTRHO
+
+
+static const char* USAGE =
+    "usage: %s [-n instances]\n"
+    "\n"
+    "Creates many instances of the plugin the way a host loading a session\n"
+    "does, and prints how long each step took as JSON.\n";
+
+// Instances are created at the wrapper's default rate, then moved to the
+// session rate before they are activated
+static const double SESSION_RATE = 48000.0;
+static const uint32_t BLOCK_SIZE = 256;
+
+enum Step { CREATE, SET_RATE, ACTIVATE, DEACTIVATE, DESTROY, NUM_STEPS };
+
+static const char* stepNames[] = {
+    "create", "set_rate", "activate", "deactivate", "destroy",
+};
+
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+static double percentile(std::vector<double> times, double p) {
+    std::sort(times.begin(), times.end());
+    return times[std::min((size_t) (p * times.size()), times.size() - 1)];
+}
+
+
+int main(int argc, char** argv) {
+    std::setlocale(LC_ALL, "C");
+
+    uint32_t count = 256;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "-n" && i + 1 < argc) {
+            count = std::atoi(argv[++i]);
+        } else {
+            std::fprintf(stderr, USAGE, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (count == 0) {
+        std::fprintf(stderr, USAGE, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    d_lastBufferSize = BLOCK_SIZE;
+    d_lastSampleRate = 44100.0;
+
+    std::vector<double> times[NUM_STEPS];
+    std::vector<double> ready;
+    std::vector<std::unique_ptr<PluginExporter>> plugins;
+    std::string label;
+
+    // Everything is created and activated before anything is torn down,
+    // as in a session that is loaded and later closed
+    for (uint32_t i = 0; i < count; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        plugins.emplace_back(new PluginExporter());
+        times[CREATE].push_back(elapsed(start));
+
+        auto step = std::chrono::steady_clock::now();
+        plugins.back()->setSampleRate(SESSION_RATE, true);
+        times[SET_RATE].push_back(elapsed(step));
+
+        step = std::chrono::steady_clock::now();
+        plugins.back()->activate();
+        times[ACTIVATE].push_back(elapsed(step));
+        ready.push_back(elapsed(start));
+    }
+    label = plugins.front()->getLabel();
+
+    for (auto& plugin : plugins) {
+        auto start = std::chrono::steady_clock::now();
+        plugin->deactivate();
+        times[DEACTIVATE].push_back(elapsed(start));
+
+        start = std::chrono::steady_clock::now();
+        plugin.reset();
+        times[DESTROY].push_back(elapsed(start));
+    }
+
+    Object steps;
+    for (uint32_t s = 0; s < NUM_STEPS; ++s) {
+        Object step;
+        step.item("median_us", Syntax().number(percentile(times[s], 0.5)));
+        step.item("worst_us", Syntax().number(percentile(times[s], 1.0)));
+        steps.item(stepNames[s], Syntax().object(step));
+    }
+
+    Object obj;
+    obj.item("plugin", Syntax().string(label));
+    obj.item("instances", Syntax().number(count));
+    obj.item("rate", Syntax().number(SESSION_RATE));
+    obj.item("ready_median_us", Syntax().number(percentile(ready, 0.5)));
+    obj.item("ready_worst_us", Syntax().number(percentile(ready, 1.0)));
+    obj.item("steps", Syntax().object(steps));
+
+    Syntax().object(obj).output();
+    std::cout << std::endl;
+
+    return EXIT_SUCCESS;
+}
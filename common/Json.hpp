@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <string>
+
+// Minimal JSON writer shared by the programs that run on the build machine
+
+#define BOOL(WHOMST) Syntax().keyword((WHOMST) ? "true" : "false")
+
+
+enum Token {
+    Colon,
+    Comma,
+    PopArray,
+    PopObject,
+    PushArray,
+    PushObject,
+    Whatever,
+};
+
+
+class Syntax {
+public:
+    std::deque<Token> tokens;
+    std::deque<std::string> strings;
+
+    Syntax() {}
+    Syntax(const Syntax&) = delete;
+    virtual ~Syntax() {}
+
+    void output() {
+        while (tokens.size() != 0) {
+            Token token = tokens.front();
+            switch (token) {
+                case Colon: std::cout << ":"; break;
+                case Comma: std::cout << ","; break;
+                case PopArray: std::cout << "]"; break;
+                case PopObject: std::cout << "}"; break;
+                case PushArray: std::cout << "["; break;
+                case PushObject: std::cout << "{"; break;
+                case Whatever: std::cout << strings.front(); strings.pop_front(); break;
+            }
+            tokens.pop_front();
+        }
+    }
+
+    Syntax& merge(const Syntax& other) {
+        tokens.insert(tokens.end(), other.tokens.begin(), other.tokens.end());
+        strings.insert(strings.end(), other.strings.begin(), other.strings.end());
+        return *this;
+    }
+
+    Syntax& object(class Object& object);
+    Syntax& array(class Array& array);
+    Syntax& string(std::string string);
+    Syntax& number(double number);
+    Syntax& keyword(std::string keyword);
+};
+
+
+class Array : public Syntax {
+public:
+    Array() {}
+    Array(const Array&) = delete;
+    virtual ~Array() {}
+
+    Array& item(Syntax& item) {
+        if (tokens.size() != 0) {
+            tokens.push_back(Comma);
+        }
+        merge(item);
+        return *this;
+    }
+};
+
+
+class Object : public Syntax {
+public:
+    Object() {}
+    Object(const Object&) = delete;
+    virtual ~Object() {}
+
+    Object& item(std::string key, Syntax& item) {
+        if (tokens.size() != 0) {
+            tokens.push_back(Comma);
+        }
+        merge(Syntax().string(key));
+        tokens.push_back(Colon);
+        merge(item);
+        return *this;
+    }
+};
+
+
+inline Syntax& Syntax::object(Object& object) {
+    tokens.push_back(PushObject);
+    merge(object);
+    tokens.push_back(PopObject);
+    return *this;
+}
+
+
+inline Syntax& Syntax::array(Array& array) {
+    tokens.push_back(PushArray);
+    merge(array);
+    tokens.push_back(PopArray);
+    return *this;
+}
+
+
+inline Syntax& Syntax::string(std::string string) {
+    tokens.push_back(Whatever);
+    strings.push_back(std::string("\"") + string + std::string("\""));
+    return *this;
+}
+
+
+// 15 significant digits when they read back as the same double, 17
+// otherwise: 256 prints as 256 and 0.1 as 0.1, while a double that needs
+// more digits keeps them. JSON has no infinities or NaN, so those are null.
+inline Syntax& Syntax::number(double number) {
+    if (!std::isfinite(number)) {
+        return keyword("null");
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.15g", number);
+    if (std::strtod(text, nullptr) != number) {
+        std::snprintf(text, sizeof(text), "%.17g", number);
+    }
+    tokens.push_back(Whatever);
+    strings.push_back(text);
+    return *this;
+}
+
+
+inline Syntax& Syntax::keyword(std::string keyword) {
+    tokens.push_back(Whatever);
+    strings.push_back(keyword);
+    return *this;
+}
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "Channels.hpp"
+
 #if defined(DISTRHO_PLUGIN_TARGET_VST)
     #define LABEL(X) DISTRHO_PLUGIN_NAME
 #else
-    #define LABEL(X) X
+    #define LABEL(X) X BITROT_CHANNEL_SUFFIX
 #endif
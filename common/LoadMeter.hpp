@@ -0,0 +1,161 @@
+#pragma once
+
+#include "DistrhoPlugin.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// DSP load of one instance, reported to the host through output parameters
+//
+// Built with BITROT_LOAD_METER, every plugin appends these parameters to
+// its own and wraps run() in begin() and end(). Without it the meter has no
+// parameters and every call compiles to nothing.
+
+#if defined(BITROT_LOAD_METER)
+
+#include <algorithm>
+#include <chrono>
+
+class LoadMeter {
+public:
+    static constexpr uint32_t NUM_PARAMS = 5;
+
+    // Reading the clock once here maps in the kernel page behind it, so the
+    // first block does not take a page fault for it
+    LoadMeter()
+        : start(Clock::now()),
+          average(0.f),
+          peak(0.f),
+          windowPeak(0.f),
+          windowFrames(0),
+          rate(44100.0),
+          memory(0.f) {}
+
+    static void initParameter(uint32_t index, Parameter& p) {
+        p.hints = kParameterIsOutput;
+        p.ranges.min = 0.f;
+        p.ranges.def = 0.f;
+
+        switch (index) {
+        case 0:
+            p.name   = "DSP Time";
+            p.symbol = "dsp_time";
+            p.unit   = "ns/frame";
+            p.ranges.max = 10000.f;
+            break;
+        case 1:
+            p.name   = "DSP Peak Time";
+            p.symbol = "dsp_peak_time";
+            p.unit   = "ns/frame";
+            p.ranges.max = 10000.f;
+            break;
+        case 2:
+            p.name   = "DSP Load";
+            p.symbol = "dsp_load";
+            p.unit   = "%";
+            p.ranges.max = 100.f;
+            break;
+        case 3:
+            p.name   = "DSP Peak Load";
+            p.symbol = "dsp_peak_load";
+            p.unit   = "%";
+            p.ranges.max = 100.f;
+            break;
+        case 4:
+            p.name   = "Buffer Memory";
+            p.symbol = "memory";
+            p.unit   = "KiB";
+            p.ranges.max = 1048576.f;
+            break;
+        default:
+            break;
+        }
+    }
+
+    float getParameterValue(uint32_t index) const {
+        switch (index) {
+        case 0:
+            return average;
+        case 1:
+            return peak;
+        case 2:
+            return average * rate * 1e-7;
+        case 3:
+            return peak * rate * 1e-7;
+        case 4:
+            return memory;
+        default:
+            return 0.f;
+        }
+    }
+
+    void setRate(double newRate) {
+        rate = newRate;
+    }
+
+    void setMemory(size_t bytes) {
+        memory = bytes / 1024.f;
+    }
+
+    void begin() {
+        start = Clock::now();
+    }
+
+    // The average follows the last AVERAGE_SECONDS or so of audio. The peak
+    // is the slowest block of the previous PEAK_SECONDS.
+    void end(uint32_t nframes) {
+        if (nframes == 0) {
+            return;
+        }
+
+        float ns(std::chrono::duration<float, std::nano>(Clock::now() - start).count());
+        float perFrame(ns / nframes);
+
+        float weight(std::min(1.f, (float) (nframes / (rate * AVERAGE_SECONDS))));
+        average += (perFrame - average) * weight;
+
+        windowPeak = std::max(windowPeak, perFrame);
+        windowFrames += nframes;
+        if (windowFrames >= rate * PEAK_SECONDS) {
+            peak = windowPeak;
+            windowPeak = 0.f;
+            windowFrames = 0;
+        }
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr double AVERAGE_SECONDS = 1.0;
+    static constexpr double PEAK_SECONDS = 1.0;
+
+    Clock::time_point start;
+
+    float average;
+    float peak;
+    float windowPeak;
+    uint32_t windowFrames;
+
+    double rate;
+    float memory;
+};
+
+#else
+
+class LoadMeter {
+public:
+    static constexpr uint32_t NUM_PARAMS = 0;
+
+    static void initParameter(uint32_t, Parameter&) {}
+
+    float getParameterValue(uint32_t) const {
+        return 0.f;
+    }
+
+    void setRate(double) {}
+    void setMemory(size_t) {}
+    void begin() {}
+    void end(uint32_t) {}
+};
+
+#endif
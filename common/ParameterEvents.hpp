@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+struct ParameterEvent {
+    uint32_t frame;
+    uint32_t index;
+    float value;
+};
+
+
+// Implemented by plugins that accept timestamped parameter changes, so that
+// drivers holding a plain Plugin* can schedule them.
+class TimedParameters {
+public:
+    virtual ~TimedParameters() {}
+    virtual bool setParameterValueAt(uint32_t frame, uint32_t index, float value) = 0;
+};
+
+
+// Parameter changes scheduled at frame offsets into the next block.
+//
+// split() runs the block in segments and applies each event right before the
+// frame it is due at, so toggles and triggers land on the exact sample no
+// matter how large the block is. Events past the end of the block carry over
+// to the next one.
+class ParameterEvents {
+public:
+    static constexpr uint32_t CAPACITY = 256;
+
+    ParameterEvents() : count(0) {}
+
+    bool push(uint32_t frame, uint32_t index, float value) {
+        if (count == CAPACITY) {
+            return false;
+        }
+
+        // Keep events ordered by frame, and in arrival order within a frame
+        uint32_t i = count;
+        while (i > 0 && events[i - 1].frame > frame) {
+            events[i] = events[i - 1];
+            --i;
+        }
+        events[i] = ParameterEvent { frame, index, value };
+        ++count;
+        return true;
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+    template <uint32_t CHANNELS, typename Apply, typename Process>
+    void split(const float** inputs, float** outputs, uint32_t nframes,
+               Apply apply, Process process) {
+        const float* in[CHANNELS];
+        float* out[CHANNELS];
+        uint32_t next = 0;
+        uint32_t offset = 0;
+
+        while (offset < nframes) {
+            while (next < count && events[next].frame <= offset) {
+                apply(events[next++]);
+            }
+
+            uint32_t end = nframes;
+            if (next < count) {
+                end = std::min(events[next].frame, nframes);
+            }
+
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                in[c] = inputs[c] + offset;
+                out[c] = outputs[c] + offset;
+            }
+            process(in, out, end - offset);
+
+            offset = end;
+        }
+
+        uint32_t left = 0;
+        for (uint32_t e = next; e < count; ++e) {
+            events[left] = events[e];
+            events[left].frame -= nframes;
+            ++left;
+        }
+        count = left;
+    }
+
+private:
+    ParameterEvent events[CAPACITY];
+    uint32_t count;
+};
@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DistrhoPlugin.hpp"
+#include "src/DistrhoPluginInternal.hpp"
+#include "DistrhoPluginInfo.h"
+#include "ParameterEvents.hpp"
+
+
+START_NAMESPACE_DISTRHO
+Plugin* createPlugin();
+END_NAMESPACE_DISTRHO
+
+
+static const char* USAGE =
+    "usage: %s [-b blocksize] [-s symbol=value]... [-a automation] in.wav out.wav\n"
+    "\n"
+    "Renders in.wav through the plugin into a 32-bit float out.wav.\n"
+    "\n"
+    "  -b blocksize   frames per run() call (default 256)\n"
+    "  -s sym=value   set a parameter before rendering\n"
+    "  -a automation  file with one '<seconds> <symbol> <value>' per line\n"
+    "\n"
+    "The input may be 16 or 24 bit PCM or 32 bit float. A mono input feeds\n"
+    "every plugin input, extra input channels are ignored.\n";
+
+
+// A whole file mapped into memory, either read only or created read/write
+// at a given size
+class MappedFile {
+public:
+    uint8_t* data;
+    size_t size;
+
+    MappedFile() : data(nullptr), size(0) {}
+    MappedFile(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data != nullptr) {
+            munmap(data, size);
+        }
+    }
+
+    bool openRead(const char* path) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+
+        size = st.st_size;
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+
+        data = (uint8_t*) p;
+        madvise(data, size, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    bool create(const char* path, size_t newSize) {
+        int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+
+        if (ftruncate(fd, newSize) != 0) {
+            close(fd);
+            return false;
+        }
+
+        size = newSize;
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+
+        data = (uint8_t*) p;
+        madvise(data, size, MADV_SEQUENTIAL);
+        return true;
+    }
+};
+
+
+static uint16_t get16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+
+enum SampleFormat {
+    Pcm16,
+    Pcm24,
+    Float32,
+};
+
+
+struct WavInfo {
+    SampleFormat format;
+    uint32_t channels;
+    uint32_t rate;
+    uint32_t frames;
+    const uint8_t* samples;
+};
+
+
+static bool parseWav(const uint8_t* p, size_t size, WavInfo& info) {
+    if (size < 12 || std::memcmp(p, "RIFF", 4) != 0 || std::memcmp(p + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    const uint8_t* fmt = nullptr;
+    size_t pos = 12;
+
+    while (pos + 8 <= size) {
+        const uint8_t* chunk(p + pos);
+        size_t length = get32(chunk + 4);
+        size_t available(std::min(length, size - pos - 8));
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+            fmt = chunk + 8;
+        } else if (std::memcmp(chunk, "data", 4) == 0 && fmt != nullptr) {
+            uint16_t tag = get16(fmt);
+            uint16_t bits = get16(fmt + 14);
+
+            // WAVE_FORMAT_EXTENSIBLE keeps the actual tag in its sub format
+            if (tag == 0xfffe && available >= 26) {
+                tag = get16(fmt + 24);
+            }
+
+            if (tag == 1 && bits == 16) {
+                info.format = Pcm16;
+            } else if (tag == 1 && bits == 24) {
+                info.format = Pcm24;
+            } else if (tag == 3 && bits == 32) {
+                info.format = Float32;
+            } else {
+                return false;
+            }
+
+            info.channels = get16(fmt + 2);
+            info.rate = get32(fmt + 4);
+            if (info.channels == 0 || info.rate == 0) {
+                return false;
+            }
+
+            info.frames = available / (info.channels * (bits / 8));
+            info.samples = chunk + 8;
+            return true;
+        }
+
+        // Chunks are padded to an even length
+        pos += 8 + length + (length & 1);
+    }
+
+    return false;
+}
+
+
+// Read frames [frame, frame + n) of the input straight into the planar
+// plugin buffers
+static void deinterleave(const WavInfo& in, uint32_t frame, uint32_t n,
+                         float** out, uint32_t channels) {
+    for (uint32_t c = 0; c < channels; ++c) {
+        uint32_t source(c < in.channels ? c : in.channels - 1);
+        float* dst(out[c]);
+
+        switch (in.format) {
+        case Pcm16: {
+            const uint8_t* p(in.samples + ((size_t) frame * in.channels + source) * 2);
+            for (uint32_t i = 0; i < n; ++i, p += in.channels * 2) {
+                dst[i] = (int16_t) get16(p) * (1.f / 32768.f);
+            }
+            break;
+        }
+        case Pcm24: {
+            const uint8_t* p(in.samples + ((size_t) frame * in.channels + source) * 3);
+            for (uint32_t i = 0; i < n; ++i, p += in.channels * 3) {
+                int32_t x((int32_t) ((uint32_t) p[0] << 8 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 24));
+                dst[i] = (x >> 8) * (1.f / 8388608.f);
+            }
+            break;
+        }
+        case Float32: {
+            const uint8_t* p(in.samples + ((size_t) frame * in.channels + source) * 4);
+            for (uint32_t i = 0; i < n; ++i, p += in.channels * 4) {
+                std::memcpy(&dst[i], p, 4);
+            }
+            break;
+        }
+        }
+    }
+}
+
+
+// Write the planar plugin outputs straight into the mapped output file
+static void interleave(uint8_t* samples, uint32_t frame, uint32_t n,
+                       float** in, uint32_t channels) {
+    for (uint32_t c = 0; c < channels; ++c) {
+        uint8_t* p(samples + ((size_t) frame * channels + c) * 4);
+        for (uint32_t i = 0; i < n; ++i, p += channels * 4) {
+            std::memcpy(p, &in[c][i], 4);
+        }
+    }
+}
+
+
+static const size_t HEADER_SIZE = 58;
+
+static void writeHeader(uint8_t* p, uint32_t channels, uint32_t rate, uint32_t frames) {
+    uint32_t dataSize(frames * channels * 4);
+
+    std::memcpy(p, "RIFF", 4);
+    put32(p + 4, HEADER_SIZE - 8 + dataSize);
+    std::memcpy(p + 8, "WAVE", 4);
+
+    std::memcpy(p + 12, "fmt ", 4);
+    put32(p + 16, 18);
+    put16(p + 20, 3);
+    put16(p + 22, channels);
+    put32(p + 24, rate);
+    put32(p + 28, rate * channels * 4);
+    put16(p + 32, channels * 4);
+    put16(p + 34, 32);
+    put16(p + 36, 0);
+
+    std::memcpy(p + 38, "fact", 4);
+    put32(p + 42, 4);
+    put32(p + 46, frames);
+
+    std::memcpy(p + 50, "data", 4);
+    put32(p + 54, dataSize);
+}
+
+
+static int findParameter(PluginExporter& plugin, const std::string& symbol) {
+    for (uint32_t i = 0; i < plugin.getParameterCount(); ++i) {
+        if (symbol == plugin.getParameterSymbol(i).buffer()) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+static bool loadAutomation(PluginExporter& plugin, const char* path, double rate,
+                           std::vector<ParameterEvent>& events) {
+    std::ifstream file(path);
+    if (!file) {
+        std::fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+
+    std::string line;
+    uint32_t number = 0;
+    while (std::getline(file, line)) {
+        ++number;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        double seconds;
+        std::string symbol;
+        float value;
+        if (!(fields >> seconds >> symbol >> value) || seconds < 0.0) {
+            std::fprintf(stderr, "%s:%u: expected '<seconds> <symbol> <value>'\n",
+                         path, number);
+            return false;
+        }
+
+        int index = findParameter(plugin, symbol);
+        if (index < 0) {
+            std::fprintf(stderr, "%s:%u: unknown parameter '%s'\n",
+                         path, number, symbol.c_str());
+            return false;
+        }
+
+        uint32_t frame = std::llround(seconds * rate);
+        events.push_back(ParameterEvent { frame, (uint32_t) index, value });
+    }
+
+    std::stable_sort(events.begin(), events.end(),
+        [](const ParameterEvent& a, const ParameterEvent& b) {
+            return a.frame < b.frame;
+        });
+    return true;
+}
+
+
+int main(int argc, char** argv) {
+    std::setlocale(LC_ALL, "C");
+
+    uint32_t blockSize = 256;
+    std::vector<std::string> settings;
+    const char* automation = nullptr;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "-b" && i + 1 < argc) {
+            blockSize = std::atoi(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            settings.push_back(argv[++i]);
+        } else if (arg == "-a" && i + 1 < argc) {
+            automation = argv[++i];
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::fprintf(stderr, USAGE, argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.size() != 2 || blockSize == 0) {
+        std::fprintf(stderr, USAGE, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    MappedFile input;
+    WavInfo in;
+    if (!input.openRead(paths[0])) {
+        std::fprintf(stderr, "cannot read %s\n", paths[0]);
+        return EXIT_FAILURE;
+    }
+    if (!parseWav(input.data, input.size, in)) {
+        std::fprintf(stderr, "%s: not a 16/24 bit PCM or 32 bit float WAV file\n", paths[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t outputSize(HEADER_SIZE + (uint64_t) in.frames * DISTRHO_PLUGIN_NUM_OUTPUTS * 4);
+    if (outputSize > 0xffffffffu) {
+        std::fprintf(stderr, "%s: too long for a WAV output\n", paths[0]);
+        return EXIT_FAILURE;
+    }
+
+    d_lastBufferSize = blockSize;
+    d_lastSampleRate = in.rate;
+
+    PluginExporter plugin;
+
+    for (const std::string& setting : settings) {
+        size_t eq = setting.find('=');
+        int index = findParameter(plugin, setting.substr(0, eq));
+        if (eq == std::string::npos || index < 0) {
+            std::fprintf(stderr, "unknown parameter setting '%s'\n", setting.c_str());
+            return EXIT_FAILURE;
+        }
+        plugin.setParameterValue(index, std::atof(setting.substr(eq + 1).c_str()));
+    }
+
+    std::vector<ParameterEvent> events;
+    if (automation != nullptr && !loadAutomation(plugin, automation, in.rate, events)) {
+        return EXIT_FAILURE;
+    }
+
+    // Automation goes to the plugin itself so that it lands on the exact
+    // frame; plugins without timed parameters get it at block boundaries
+    Plugin* instance = (Plugin*) plugin.getInstancePointer();
+    TimedParameters* timed = dynamic_cast<TimedParameters*>(instance);
+
+    MappedFile output;
+    if (!output.create(paths[1], outputSize)) {
+        std::fprintf(stderr, "cannot write %s\n", paths[1]);
+        return EXIT_FAILURE;
+    }
+    writeHeader(output.data, DISTRHO_PLUGIN_NUM_OUTPUTS, in.rate, in.frames);
+
+    std::vector<float> buffers(
+        (DISTRHO_PLUGIN_NUM_INPUTS + DISTRHO_PLUGIN_NUM_OUTPUTS) * blockSize);
+    float* inputs[DISTRHO_PLUGIN_NUM_INPUTS];
+    float* outputs[DISTRHO_PLUGIN_NUM_OUTPUTS];
+    for (uint32_t c = 0; c < DISTRHO_PLUGIN_NUM_INPUTS; ++c) {
+        inputs[c] = &buffers[c * blockSize];
+    }
+    for (uint32_t c = 0; c < DISTRHO_PLUGIN_NUM_OUTPUTS; ++c) {
+        outputs[c] = &buffers[(DISTRHO_PLUGIN_NUM_INPUTS + c) * blockSize];
+    }
+
+    plugin.activate();
+
+    size_t next = 0;
+    for (uint32_t frame = 0; frame < in.frames;) {
+        uint32_t n(std::min(blockSize, in.frames - frame));
+
+        size_t end = next;
+        while (end < events.size() && events[end].frame < frame + n) {
+            ++end;
+        }
+
+        if (timed == nullptr) {
+            for (; next < end; ++next) {
+                plugin.setParameterValue(events[next].index, events[next].value);
+            }
+        } else {
+            // The queue is empty between runs, so what is due at the first
+            // frame can be set right away. Should the rest not fit in the
+            // queue, the run ends at the frame of the first event left over.
+            for (; next < end && events[next].frame <= frame; ++next) {
+                plugin.setParameterValue(events[next].index, events[next].value);
+            }
+            if (end - next > ParameterEvents::CAPACITY) {
+                n = events[next + ParameterEvents::CAPACITY].frame - frame;
+                while (events[end - 1].frame >= frame + n) {
+                    --end;
+                }
+            }
+            for (; next < end; ++next) {
+                const ParameterEvent& e(events[next]);
+                timed->setParameterValueAt(e.frame - frame, e.index, e.value);
+            }
+        }
+
+        deinterleave(in, frame, n, inputs, DISTRHO_PLUGIN_NUM_INPUTS);
+        plugin.run((const float**) inputs, outputs, n);
+        interleave(output.data + HEADER_SIZE, frame, n, outputs, DISTRHO_PLUGIN_NUM_OUTPUTS);
+        frame += n;
+    }
+
+    plugin.deactivate();
+
+    return EXIT_SUCCESS;
+}
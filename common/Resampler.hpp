@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Polyphase windowed-sinc resampler
+//
+// Kernels are precomputed for a handful of cutoff bands, so reading at any
+// speed costs a fixed number of taps per output frame. Speeds above 1 pick a
+// band with a lower cutoff to suppress aliasing, speeds at or below 1 use the
+// full band and simply interpolate.
+class Resampler {
+public:
+    enum Quality {
+        Low,
+        Medium,
+        High,
+        NUM_QUALITIES
+    };
+
+    static constexpr uint32_t NUM_BANDS = 8;
+    static constexpr double MAX_SPEED = 4.0;
+    static constexpr double ROLLOFF = 0.9;
+
+    struct Position {
+        int32_t base;
+        const float* kernel;
+    };
+
+    // The tables are shared by every instance and built on first use, so
+    // call this from the constructor rather than from run().
+    static const Resampler& get(Quality quality) {
+        static const Resampler resamplers[NUM_QUALITIES] = {
+            Resampler(8, 64),
+            Resampler(16, 128),
+            Resampler(32, 256),
+        };
+        return resamplers[std::min(quality, High)];
+    }
+
+    uint32_t taps() const {
+        return numTaps;
+    }
+
+    Position locate(double pos, double speed) const {
+        double whole(std::floor(pos));
+        uint32_t phase((uint32_t) ((pos - whole) * numPhases + 0.5));
+
+        Position p;
+        p.base = (int32_t) whole + 1 - (int32_t) (numTaps / 2);
+        p.kernel = &table[(band(speed) * (numPhases + 1) + phase) * numTaps];
+        return p;
+    }
+
+    // Samples outside [0, size) read as silence.
+    float read(const float* buffer, int32_t size, const Position& p) const {
+        const float* h(p.kernel);
+        float y(0.f);
+
+        if (p.base >= 0 && p.base + (int32_t) numTaps <= size) {
+            const float* x(buffer + p.base);
+            for (uint32_t t = 0; t < numTaps; ++t) {
+                y += x[t] * h[t];
+            }
+        } else {
+            for (uint32_t t = 0; t < numTaps; ++t) {
+                int32_t i(p.base + (int32_t) t);
+                if (i >= 0 && i < size) {
+                    y += buffer[i] * h[t];
+                }
+            }
+        }
+
+        return y;
+    }
+
+private:
+    uint32_t numTaps;
+    uint32_t numPhases;
+    std::vector<float> table;
+
+    Resampler(uint32_t taps, uint32_t phases)
+        : numTaps(taps)
+        , numPhases(phases)
+        , table(NUM_BANDS * (phases + 1) * taps)
+    {
+        for (uint32_t b = 0; b < NUM_BANDS; ++b) {
+            double cutoff(ROLLOFF / bandSpeed(b));
+
+            for (uint32_t phase = 0; phase <= numPhases; ++phase) {
+                float* h(&table[(b * (numPhases + 1) + phase) * numTaps]);
+                double frac((double) phase / (double) numPhases);
+                double sum(0.0);
+
+                for (uint32_t t = 0; t < numTaps; ++t) {
+                    double d(t + 1.0 - (numTaps / 2) - frac);
+                    double w(blackman((d + numTaps * 0.5) / numTaps));
+                    h[t] = (float) (cutoff * sinc(cutoff * d) * w);
+                    sum += h[t];
+                }
+
+                for (uint32_t t = 0; t < numTaps; ++t) {
+                    h[t] = (float) (h[t] / sum);
+                }
+            }
+        }
+    }
+
+    static double bandSpeed(uint32_t b) {
+        return 1.0 + (MAX_SPEED - 1.0) * b / (double) (NUM_BANDS - 1);
+    }
+
+    // Lowest band whose cutoff is at or below the Nyquist rate at `speed`
+    static uint32_t band(double speed) {
+        if (speed <= 1.0) {
+            return 0;
+        }
+        double b(std::ceil((speed - 1.0) * (NUM_BANDS - 1) / (MAX_SPEED - 1.0)));
+        return std::min((uint32_t) b, NUM_BANDS - 1);
+    }
+
+    static double sinc(double x) {
+        if (x == 0.0) {
+            return 1.0;
+        }
+        return std::sin(M_PI * x) / (M_PI * x);
+    }
+
+    static double blackman(double x) {
+        return 0.42 - 0.5 * std::cos(2.0 * M_PI * x) + 0.08 * std::cos(4.0 * M_PI * x);
+    }
+};
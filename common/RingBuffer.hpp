@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#include "SampleBuffer.hpp"
+
+// Circular buffer of samples
+//
+// The capacity is rounded up to a power of two, so a position selects its
+// slot with a mask. Positions are free running counters: they can be moved
+// forwards and backwards without ever being wrapped by hand.
+template <typename T>
+class RingBuffer {
+public:
+    // A run of consecutive slots
+    struct Segment {
+        T* data;
+        uint32_t size;
+    };
+
+    // A span of positions covered by at most two segments, in reading order
+    struct Span {
+        Segment first;
+        Segment second;
+    };
+
+    RingBuffer() : mask(0) {}
+
+    // Room for at least n samples, accounted to owner. New memory is all
+    // zero; a buffer that already has the right capacity is left as it is.
+    // Returns whether the memory is new.
+    bool resize(uint32_t n, const char* owner) {
+        uint32_t capacity(1);
+        while (capacity < n) {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        return samples.resize(capacity, owner);
+    }
+
+    void clear() {
+        std::fill(samples.data(), samples.data() + samples.size(), T(0));
+    }
+
+    // Back the samples with memory ahead of run()
+    void prefault() {
+        samples.prefault();
+    }
+
+    uint32_t capacity() const {
+        return samples.size();
+    }
+
+    T& operator[](uint32_t pos) {
+        return samples[pos & mask];
+    }
+
+    const T& operator[](uint32_t pos) const {
+        return samples[pos & mask];
+    }
+
+    // Positions pos, pos + 1, ..., pos + n - 1
+    Span span(uint32_t pos, uint32_t n) {
+        uint32_t start(pos & mask);
+        uint32_t first(std::min(n, capacity() - start));
+        return Span {
+            Segment { samples.data() + start, first },
+            Segment { samples.data(), n - first },
+        };
+    }
+
+    // Positions pos, pos - 1, ..., pos - n + 1. Each segment is read from
+    // its last slot down.
+    Span reversedSpan(uint32_t pos, uint32_t n) {
+        uint32_t end((pos & mask) + 1);
+        uint32_t first(std::min(n, end));
+        return Span {
+            Segment { samples.data() + end - first, first },
+            Segment { samples.data() + capacity() - (n - first), n - first },
+        };
+    }
+
+    void write(uint32_t pos, const T* in, uint32_t n) {
+        Span s(span(pos, n));
+        std::memcpy(s.first.data, in, sizeof(T) * s.first.size);
+        std::memcpy(s.second.data, in + s.first.size, sizeof(T) * s.second.size);
+    }
+
+    void read(uint32_t pos, T* out, uint32_t n) {
+        Span s(span(pos, n));
+        std::memcpy(out, s.first.data, sizeof(T) * s.first.size);
+        std::memcpy(out + s.first.size, s.second.data, sizeof(T) * s.second.size);
+    }
+
+    void readReversed(uint32_t pos, T* out, uint32_t n) {
+        Span s(reversedSpan(pos, n));
+        for (const Segment& seg : { s.first, s.second }) {
+            for (uint32_t i = 0; i < seg.size; ++i) {
+                out[i] = seg.data[seg.size - 1 - i];
+            }
+            out += seg.size;
+        }
+    }
+
+private:
+    SampleBuffer<T> samples;
+    uint32_t mask;
+};
@@ -0,0 +1,420 @@
+#include <algorithm>
+#include <cerrno>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+#include <link.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "DistrhoPlugin.hpp"
+#include "src/DistrhoPluginInternal.hpp"
+#include "DistrhoPluginInfo.h"
+#include "Json.hpp"
+#include "ParameterEvents.hpp"
+
+
+START_NAMESPACE_DISTRHO
+Plugin* createPlugin();
+END_NAMESPACE_DISTRHO
+
+
+// Everything that is not allowed on the audio thread. While `armed` is set
+// the interposers below count each call they see, and the block loop adds
+// the page faults and context switches getrusage() reports around it.
+enum Violation {
+    ALLOCATION,
+    DEALLOCATION,
+    LOCK,
+    BLOCKING_CALL,
+    PAGE_FAULT,
+    CONTEXT_SWITCH,
+    NUM_VIOLATIONS
+};
+
+static const char* VIOLATION_NAMES[NUM_VIOLATIONS] = {
+    "allocation",
+    "deallocation",
+    "lock",
+    "blocking_call",
+    "page_fault",
+    "context_switch",
+};
+
+static bool armed = false;
+static uint64_t counts[NUM_VIOLATIONS];
+static const char* lastCall[NUM_VIOLATIONS];
+
+static void violation(Violation v, const char* call) {
+    if (armed) {
+        ++counts[v];
+        lastCall[v] = call;
+    }
+}
+
+
+// Allocator interposers. They go straight to glibc's own entry points, so
+// they never recurse into each other.
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void __libc_free(void*);
+
+void* malloc(size_t n) {
+    violation(ALLOCATION, "malloc");
+    return __libc_malloc(n);
+}
+
+void* calloc(size_t n, size_t size) {
+    violation(ALLOCATION, "calloc");
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t n) {
+    violation(ALLOCATION, "realloc");
+    return __libc_realloc(p, n);
+}
+
+void* memalign(size_t alignment, size_t n) {
+    violation(ALLOCATION, "memalign");
+    return __libc_memalign(alignment, n);
+}
+
+void* aligned_alloc(size_t alignment, size_t n) {
+    violation(ALLOCATION, "aligned_alloc");
+    return __libc_memalign(alignment, n);
+}
+
+int posix_memalign(void** p, size_t alignment, size_t n) {
+    violation(ALLOCATION, "posix_memalign");
+    *p = __libc_memalign(alignment, n);
+    return *p != nullptr ? 0 : ENOMEM;
+}
+
+void free(void* p) {
+    violation(DEALLOCATION, "free");
+    __libc_free(p);
+}
+}
+
+static void* allocate(size_t n, const char* call) {
+    violation(ALLOCATION, call);
+    void* p = __libc_malloc(n != 0 ? n : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t n) {
+    return allocate(n, "operator new");
+}
+
+void* operator new[](size_t n) {
+    return allocate(n, "operator new[]");
+}
+
+void* operator new(size_t n, const std::nothrow_t&) noexcept {
+    violation(ALLOCATION, "operator new");
+    return __libc_malloc(n != 0 ? n : 1);
+}
+
+void* operator new[](size_t n, const std::nothrow_t&) noexcept {
+    violation(ALLOCATION, "operator new[]");
+    return __libc_malloc(n != 0 ? n : 1);
+}
+
+void operator delete(void* p) noexcept {
+    violation(DEALLOCATION, "operator delete");
+    __libc_free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    violation(DEALLOCATION, "operator delete[]");
+    __libc_free(p);
+}
+
+
+// Locks and calls that may block. The real functions are looked up before
+// anything is armed, since dlsym() itself may allocate.
+#define INTERPOSE(KIND, RET, NAME, PARAMS, ARGS)                    \
+    static RET (*real_##NAME) PARAMS;                                \
+    extern "C" RET NAME PARAMS {                                     \
+        violation(KIND, #NAME);                                      \
+        return real_##NAME ARGS;                                     \
+    }
+
+INTERPOSE(LOCK, int, pthread_mutex_lock, (pthread_mutex_t* m), (m))
+INTERPOSE(LOCK, int, pthread_mutex_trylock, (pthread_mutex_t* m), (m))
+INTERPOSE(LOCK, int, pthread_rwlock_rdlock, (pthread_rwlock_t* l), (l))
+INTERPOSE(LOCK, int, pthread_rwlock_wrlock, (pthread_rwlock_t* l), (l))
+INTERPOSE(LOCK, int, pthread_spin_lock, (pthread_spinlock_t* l), (l))
+INTERPOSE(LOCK, int, sem_wait, (sem_t* s), (s))
+INTERPOSE(BLOCKING_CALL, int, pthread_cond_wait,
+          (pthread_cond_t* c, pthread_mutex_t* m), (c, m))
+INTERPOSE(BLOCKING_CALL, int, nanosleep,
+          (const struct timespec* t, struct timespec* left), (t, left))
+INTERPOSE(BLOCKING_CALL, int, usleep, (useconds_t us), (us))
+INTERPOSE(BLOCKING_CALL, int, sched_yield, (), ())
+INTERPOSE(BLOCKING_CALL, ssize_t, read, (int fd, void* buf, size_t n), (fd, buf, n))
+INTERPOSE(BLOCKING_CALL, ssize_t, write, (int fd, const void* buf, size_t n), (fd, buf, n))
+
+#undef INTERPOSE
+
+#define RESOLVE(NAME) \
+    real_##NAME = (decltype(real_##NAME)) dlsym(RTLD_NEXT, #NAME)
+
+static void resolve() {
+    RESOLVE(pthread_mutex_lock);
+    RESOLVE(pthread_mutex_trylock);
+    RESOLVE(pthread_rwlock_rdlock);
+    RESOLVE(pthread_rwlock_wrlock);
+    RESOLVE(pthread_spin_lock);
+    RESOLVE(sem_wait);
+    RESOLVE(pthread_cond_wait);
+    RESOLVE(nanosleep);
+    RESOLVE(usleep);
+    RESOLVE(sched_yield);
+    RESOLVE(read);
+    RESOLVE(write);
+}
+
+#undef RESOLVE
+
+
+static const double RATE = 48000.0;
+static const uint32_t BLOCK_SIZES[] = { 1, 64, 256, 4096 };
+
+// Enough audio to take Reverser through its whole window and Repeat
+// through a few loops, with parameter changes all along
+static const double SECONDS = 12.0;
+
+// Stack touched before arming, as a host would by locking its memory
+static const size_t STACK_PREFAULT = 256 * 1024;
+static const size_t PAGE = 4096;
+
+
+struct Usage {
+    uint64_t faults;
+    uint64_t switches;
+};
+
+static Usage usage() {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return Usage {
+        (uint64_t) (ru.ru_minflt + ru.ru_majflt),
+        (uint64_t) ru.ru_nvcsw,
+    };
+}
+
+static void __attribute__((noinline)) prefaultStack() {
+    volatile char stack[STACK_PREFAULT];
+    for (size_t i = 0; i < STACK_PREFAULT; i += PAGE) {
+        stack[i] = 0;
+    }
+    (void) stack[0];
+}
+
+// Read every page of executable code once, so that running code for the
+// first time does not count as a page fault of the audio path. Data pages
+// are left alone: buffers a plugin has not touched yet still show up.
+static int prefaultSegments(struct dl_phdr_info* info, size_t, void*) {
+    for (int i = 0; i < info->dlpi_phnum; ++i) {
+        const ElfW(Phdr)& ph(info->dlpi_phdr[i]);
+        if (ph.p_type != PT_LOAD || !(ph.p_flags & PF_X)) {
+            continue;
+        }
+
+        uintptr_t start((info->dlpi_addr + ph.p_vaddr) & ~(uintptr_t) (PAGE - 1));
+        uintptr_t end(info->dlpi_addr + ph.p_vaddr + ph.p_memsz);
+        for (uintptr_t p = start; p < end; p += PAGE) {
+            (void) *(volatile const char*) p;
+        }
+    }
+    return 0;
+}
+
+static void prefaultCode() {
+    dl_iterate_phdr(prefaultSegments, nullptr);
+}
+
+
+// A parameter value anywhere in its range, respecting integer and boolean
+// hints so that every mode of the plugin gets visited
+static float randomValue(PluginExporter& plugin, uint32_t index, uint32_t& seed) {
+    seed = seed * 1664525 + 1013904223;
+    float t = (seed >> 8) / 16777216.f;
+
+    const ParameterRanges& ranges(plugin.getParameterRanges(index));
+    uint32_t hints(plugin.getParameterHints(index));
+    float value = ranges.min + t * (ranges.max - ranges.min);
+
+    if (hints & kParameterIsBoolean) {
+        return t < 0.5f ? ranges.min : ranges.max;
+    }
+    if (hints & kParameterIsInteger) {
+        return std::floor(value + 0.5f);
+    }
+    return value;
+}
+
+
+struct Failure {
+    uint32_t blockSize;
+    uint32_t block;
+    const char* stage;
+    uint64_t counts[NUM_VIOLATIONS];
+    const char* calls[NUM_VIOLATIONS];
+};
+
+// Run one instance with blocks of up to maxBlock frames, and collect every
+// block in which the audio path did something it must not
+static void check(uint32_t maxBlock, std::vector<Failure>& failures) {
+    d_lastBufferSize = maxBlock;
+    d_lastSampleRate = RATE;
+
+    PluginExporter plugin;
+    Plugin* instance = (Plugin*) plugin.getInstancePointer();
+    TimedParameters* timed = dynamic_cast<TimedParameters*>(instance);
+
+    std::vector<float> buffers((DISTRHO_PLUGIN_NUM_INPUTS + DISTRHO_PLUGIN_NUM_OUTPUTS) * maxBlock);
+    const float* inputs[DISTRHO_PLUGIN_NUM_INPUTS];
+    float* outputs[DISTRHO_PLUGIN_NUM_OUTPUTS];
+    for (uint32_t c = 0; c < DISTRHO_PLUGIN_NUM_INPUTS; ++c) {
+        inputs[c] = &buffers[c * maxBlock];
+    }
+    for (uint32_t c = 0; c < DISTRHO_PLUGIN_NUM_OUTPUTS; ++c) {
+        outputs[c] = &buffers[(DISTRHO_PLUGIN_NUM_INPUTS + c) * maxBlock];
+    }
+
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < DISTRHO_PLUGIN_NUM_INPUTS * maxBlock; ++i) {
+        seed = seed * 1664525 + 1013904223;
+        buffers[i] = (seed / (float) 0xffffffff) - 0.5f;
+    }
+
+    plugin.activate();
+    prefaultCode();
+
+    uint32_t numParams(plugin.getParameterCount());
+    uint32_t total = (uint32_t) (SECONDS * RATE);
+    uint32_t block = 0;
+
+    for (uint32_t frame = 0; frame < total; ++block) {
+        seed = seed * 1664525 + 1013904223;
+        uint32_t n(std::min(1 + (seed >> 8) % maxBlock, total - frame));
+
+        // A change to a random parameter every few blocks, plus one timed
+        // change inside the block when the plugin takes them
+        bool change(numParams != 0 && block % 4 == 0);
+        uint32_t index(change ? (seed >> 4) % numParams : 0);
+        float value(change ? randomValue(plugin, index, seed) : 0.f);
+        uint32_t timedIndex(change ? (seed >> 12) % numParams : 0);
+        float timedValue(change ? randomValue(plugin, timedIndex, seed) : 0.f);
+
+        prefaultStack();
+        Usage before(usage());
+
+        Failure f = Failure { maxBlock, block, "run", {}, {} };
+        std::memset(counts, 0, sizeof(counts));
+
+        armed = true;
+        if (change) {
+            plugin.setParameterValue(index, value);
+            if (timed != nullptr) {
+                timed->setParameterValueAt(n / 2, timedIndex, timedValue);
+            }
+        }
+        plugin.run(inputs, outputs, n);
+        armed = false;
+
+        Usage after(usage());
+        counts[PAGE_FAULT] += after.faults - before.faults;
+        counts[CONTEXT_SWITCH] += after.switches - before.switches;
+        lastCall[PAGE_FAULT] = "page fault";
+        lastCall[CONTEXT_SWITCH] = "voluntary context switch";
+
+        bool failed = false;
+        for (uint32_t v = 0; v < NUM_VIOLATIONS; ++v) {
+            f.counts[v] = counts[v];
+            f.calls[v] = counts[v] != 0 ? lastCall[v] : nullptr;
+            failed = failed || counts[v] != 0;
+        }
+        if (failed) {
+            f.stage = change ? "setParameterValue/run" : "run";
+            failures.push_back(f);
+        }
+
+        frame += n;
+    }
+
+    plugin.deactivate();
+}
+
+
+int main() {
+    std::setlocale(LC_ALL, "C");
+    resolve();
+
+    std::string label;
+    {
+        d_lastBufferSize = 256;
+        d_lastSampleRate = RATE;
+        PluginExporter plugin;
+        label = plugin.getLabel();
+    }
+
+    std::vector<Failure> failures;
+    failures.reserve(1024);
+    for (uint32_t blockSize : BLOCK_SIZES) {
+        check(blockSize, failures);
+    }
+
+    Array list;
+    for (size_t i = 0; i < failures.size() && i < 32; ++i) {
+        const Failure& f(failures[i]);
+        Object item;
+        item.item("block_size", Syntax().number(f.blockSize));
+        item.item("block", Syntax().number(f.block));
+        item.item("stage", Syntax().string(f.stage));
+        for (uint32_t v = 0; v < NUM_VIOLATIONS; ++v) {
+            if (f.counts[v] != 0) {
+                Object what;
+                what.item("count", Syntax().number(f.counts[v]));
+                what.item("last", Syntax().string(f.calls[v]));
+                item.item(VIOLATION_NAMES[v], Syntax().object(what));
+            }
+        }
+        list.item(Syntax().object(item));
+    }
+
+    Object obj;
+    obj.item("plugin", Syntax().string(label));
+    obj.item("is_rt_safe", BOOL(DISTRHO_PLUGIN_IS_RT_SAFE));
+    obj.item("failed_blocks", Syntax().number(failures.size()));
+    obj.item("failures", Syntax().array(list));
+
+    Syntax().object(obj).output();
+    std::cout << std::endl;
+
+    // Only a plugin that claims to be real-time safe has to pass
+    if (DISTRHO_PLUGIN_IS_RT_SAFE && !failures.empty()) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
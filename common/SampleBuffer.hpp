@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "Arena.hpp"
+
+// Fixed run of samples in the Arena, exactly as long as asked for
+//
+// For audio that is read and written in place without wrapping around.
+// Copying is not allowed, as the memory belongs to one instance.
+template <typename T>
+class SampleBuffer {
+public:
+    SampleBuffer() : samples(nullptr), length(0) {}
+
+    ~SampleBuffer() {
+        if (samples != nullptr) {
+            Arena::get().release(samples);
+        }
+    }
+
+    SampleBuffer(const SampleBuffer&) = delete;
+    SampleBuffer& operator=(const SampleBuffer&) = delete;
+
+    // Room for n samples, accounted to owner. New memory is all zero; a
+    // buffer that already has the right size is left as it is. Returns
+    // whether the memory is new.
+    bool resize(uint32_t n, const char* owner) {
+        if (n == length) {
+            return false;
+        }
+
+        Arena& arena(Arena::get());
+        if (samples != nullptr) {
+            arena.release(samples);
+        }
+        samples = static_cast<T*>(arena.allocate(sizeof(T) * n, owner));
+        length = n;
+        return true;
+    }
+
+    // Back the samples with memory ahead of run()
+    void prefault() {
+        if (samples != nullptr) {
+            Arena::get().prefault(samples);
+        }
+    }
+
+    uint32_t size() const {
+        return length;
+    }
+
+    T* data() {
+        return samples;
+    }
+
+    const T* data() const {
+        return samples;
+    }
+
+    T& operator[](uint32_t i) {
+        return samples[i];
+    }
+
+    const T& operator[](uint32_t i) const {
+        return samples[i];
+    }
+
+    void write(uint32_t pos, const T* in, uint32_t n) {
+        std::memcpy(samples + pos, in, sizeof(T) * n);
+    }
+
+private:
+    T* samples;
+    uint32_t length;
+};
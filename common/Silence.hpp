@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+// Whether a block holds nothing but zeros (of either sign)
+//
+// The samples are compared a chunk at a time. Within a chunk there are no
+// branches, so the scan vectorizes, and audio that is not silent is usually
+// told apart after the first chunk.
+inline bool isSilent(const float* x, uint32_t nframes) {
+    static constexpr uint32_t CHUNK = 64;
+
+    for (uint32_t offset = 0; offset < nframes; offset += CHUNK) {
+        const float* chunk(x + offset);
+        uint32_t n(nframes - offset < CHUNK ? nframes - offset : CHUNK);
+        uint32_t loud(0);
+        for (uint32_t i = 0; i < n; ++i) {
+            loud |= chunk[i] != 0.f;
+        }
+        if (loud != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <uint32_t CHANNELS>
+inline bool isSilent(const float** channels, uint32_t nframes) {
+    for (uint32_t c = 0; c < CHANNELS; ++c) {
+        if (!isSilent(channels[c], nframes)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Thin wrapper around the widest float vector the target supports.
+//
+// Kernels written against FloatVec compile to AVX, SSE2 or NEON, and fall
+// back to plain scalar code everywhere else. Loads and stores are unaligned.
+
+#if defined(__AVX__)
+
+#include <immintrin.h>
+
+struct FloatVec {
+    static constexpr uint32_t SIZE = 8;
+    __m256 v;
+
+    FloatVec() {}
+    FloatVec(__m256 v) : v(v) {}
+    FloatVec(float x) : v(_mm256_set1_ps(x)) {}
+
+    static FloatVec load(const float* p) { return _mm256_loadu_ps(p); }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend FloatVec operator+(FloatVec a, FloatVec b) { return _mm256_add_ps(a.v, b.v); }
+    friend FloatVec operator-(FloatVec a, FloatVec b) { return _mm256_sub_ps(a.v, b.v); }
+    friend FloatVec operator*(FloatVec a, FloatVec b) { return _mm256_mul_ps(a.v, b.v); }
+    friend FloatVec operator/(FloatVec a, FloatVec b) { return _mm256_div_ps(a.v, b.v); }
+    friend FloatVec min(FloatVec a, FloatVec b) { return _mm256_min_ps(a.v, b.v); }
+    friend FloatVec max(FloatVec a, FloatVec b) { return _mm256_max_ps(a.v, b.v); }
+    friend FloatVec truncate(FloatVec a) { return _mm256_cvtepi32_ps(_mm256_cvttps_epi32(a.v)); }
+};
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+#include <emmintrin.h>
+
+struct FloatVec {
+    static constexpr uint32_t SIZE = 4;
+    __m128 v;
+
+    FloatVec() {}
+    FloatVec(__m128 v) : v(v) {}
+    FloatVec(float x) : v(_mm_set1_ps(x)) {}
+
+    static FloatVec load(const float* p) { return _mm_loadu_ps(p); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend FloatVec operator+(FloatVec a, FloatVec b) { return _mm_add_ps(a.v, b.v); }
+    friend FloatVec operator-(FloatVec a, FloatVec b) { return _mm_sub_ps(a.v, b.v); }
+    friend FloatVec operator*(FloatVec a, FloatVec b) { return _mm_mul_ps(a.v, b.v); }
+    friend FloatVec operator/(FloatVec a, FloatVec b) { return _mm_div_ps(a.v, b.v); }
+    friend FloatVec min(FloatVec a, FloatVec b) { return _mm_min_ps(a.v, b.v); }
+    friend FloatVec max(FloatVec a, FloatVec b) { return _mm_max_ps(a.v, b.v); }
+    friend FloatVec truncate(FloatVec a) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v)); }
+};
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+#include <arm_neon.h>
+
+struct FloatVec {
+    static constexpr uint32_t SIZE = 4;
+    float32x4_t v;
+
+    FloatVec() {}
+    FloatVec(float32x4_t v) : v(v) {}
+    FloatVec(float x) : v(vdupq_n_f32(x)) {}
+
+    static FloatVec load(const float* p) { return vld1q_f32(p); }
+    void store(float* p) const { vst1q_f32(p, v); }
+
+    friend FloatVec operator+(FloatVec a, FloatVec b) { return vaddq_f32(a.v, b.v); }
+    friend FloatVec operator-(FloatVec a, FloatVec b) { return vsubq_f32(a.v, b.v); }
+    friend FloatVec operator*(FloatVec a, FloatVec b) { return vmulq_f32(a.v, b.v); }
+    friend FloatVec operator/(FloatVec a, FloatVec b) { return vdivq_f32(a.v, b.v); }
+    friend FloatVec min(FloatVec a, FloatVec b) { return vminq_f32(a.v, b.v); }
+    friend FloatVec max(FloatVec a, FloatVec b) { return vmaxq_f32(a.v, b.v); }
+    friend FloatVec truncate(FloatVec a) { return vcvtq_f32_s32(vcvtq_s32_f32(a.v)); }
+};
+
+#else
+
+struct FloatVec {
+    static constexpr uint32_t SIZE = 1;
+    float v;
+
+    FloatVec() {}
+    FloatVec(float x) : v(x) {}
+
+    static FloatVec load(const float* p) { return *p; }
+    void store(float* p) const { *p = v; }
+
+    friend FloatVec operator+(FloatVec a, FloatVec b) { return a.v + b.v; }
+    friend FloatVec operator-(FloatVec a, FloatVec b) { return a.v - b.v; }
+    friend FloatVec operator*(FloatVec a, FloatVec b) { return a.v * b.v; }
+    friend FloatVec operator/(FloatVec a, FloatVec b) { return a.v / b.v; }
+    friend FloatVec min(FloatVec a, FloatVec b) { return std::min(a.v, b.v); }
+    friend FloatVec max(FloatVec a, FloatVec b) { return std::max(a.v, b.v); }
+    friend FloatVec truncate(FloatVec a) { return (float) (int32_t) a.v; }
+};
+
+#endif
+
+static inline FloatVec clamp(FloatVec x, FloatVec lo, FloatVec hi) {
+    return min(max(x, lo), hi);
+}
+
+
+// Per-frame kernel inputs: either one value for the whole block, or a span
+// holding a value for every frame
+struct Uniform {
+    FloatVec value;
+
+    Uniform(float x) : value(x) {}
+    FloatVec operator[](uint32_t) const { return value; }
+};
+
+struct Varying {
+    const float* values;
+
+    Varying(const float* values) : values(values) {}
+    FloatVec operator[](uint32_t f) const { return FloatVec::load(values + f); }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Linear parameter ramp across a block
+//
+// The per-frame step is computed once, so reading the ramp costs a multiply
+// and an add instead of a divide. That rounds differently from interpolating
+// by i / nframes, so a ramp can differ from one in the last bit. Blocks where
+// the value does not move are flagged constant, letting callers skip
+// per-sample interpolation entirely.
+template <typename T>
+class Smoothed {
+public:
+    Smoothed(T from, T to, uint32_t nframes)
+        : from(from)
+        , step(nframes != 0 ? (to - from) / (T) nframes : T(0))
+        , constant(from == to)
+    {}
+
+    bool isConstant() const {
+        return constant;
+    }
+
+    T delta() const {
+        return step;
+    }
+
+    // Value at frame i of the block
+    T operator[](uint32_t i) const {
+        return from + step * (T) i;
+    }
+
+    // Write frames [offset, offset + n) of the block into out
+    void fill(T* out, uint32_t offset, uint32_t n) const {
+        if (constant) {
+            std::fill(out, out + n, from);
+            return;
+        }
+
+        T start(from + step * (T) offset);
+        for (uint32_t i = 0; i < n; ++i) {
+            out[i] = start + step * (T) i;
+        }
+    }
+
+private:
+    T from;
+    T step;
+    bool constant;
+};
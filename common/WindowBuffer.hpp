@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#include "SampleBuffer.hpp"
+
+// Circular buffer of samples, exactly as long as asked for
+//
+// For rings whose length is part of the sound, where rounding up to a power
+// of two like RingBuffer does would change what is heard. Positions are
+// slots, kept within [0, size()) by the caller; ranges of positions wrap
+// around the end.
+template <typename T>
+class WindowBuffer {
+public:
+    // A run of consecutive slots
+    struct Segment {
+        T* data;
+        uint32_t size;
+    };
+
+    // A span of positions covered by at most two segments, in reading order
+    struct Span {
+        Segment first;
+        Segment second;
+    };
+
+    // Room for exactly n samples, accounted to owner. New memory is all
+    // zero; a buffer that already has the right size is left as it is.
+    // Returns whether the memory is new.
+    bool resize(uint32_t n, const char* owner) {
+        return samples.resize(n, owner);
+    }
+
+    // Back the samples with memory ahead of run()
+    void prefault() {
+        samples.prefault();
+    }
+
+    uint32_t size() const {
+        return samples.size();
+    }
+
+    // Positions pos, pos + 1, ..., pos + n - 1, for n up to size()
+    Span span(uint32_t pos, uint32_t n) {
+        uint32_t first(std::min(n, size() - pos));
+        return Span {
+            Segment { samples.data() + pos, first },
+            Segment { samples.data(), n - first },
+        };
+    }
+
+    // Positions pos, pos - 1, ..., pos - n + 1, for n up to size(). Each
+    // segment is read from its last slot down.
+    Span reversedSpan(uint32_t pos, uint32_t n) {
+        uint32_t end(pos + 1);
+        uint32_t first(std::min(n, end));
+        return Span {
+            Segment { samples.data() + end - first, first },
+            Segment { samples.data() + size() - (n - first), n - first },
+        };
+    }
+
+    void write(uint32_t pos, const T* in, uint32_t n) {
+        Span s(span(pos, n));
+        std::memcpy(s.first.data, in, sizeof(T) * s.first.size);
+        std::memcpy(s.second.data, in + s.first.size, sizeof(T) * s.second.size);
+    }
+
+    void read(uint32_t pos, T* out, uint32_t n) {
+        Span s(span(pos, n));
+        std::memcpy(out, s.first.data, sizeof(T) * s.first.size);
+        std::memcpy(out + s.first.size, s.second.data, sizeof(T) * s.second.size);
+    }
+
+    void readReversed(uint32_t pos, T* out, uint32_t n) {
+        Span s(reversedSpan(pos, n));
+        for (const Segment& seg : { s.first, s.second }) {
+            for (uint32_t i = 0; i < seg.size; ++i) {
+                out[i] = seg.data[seg.size - 1 - i];
+            }
+            out += seg.size;
+        }
+    }
+
+private:
+    SampleBuffer<T> samples;
+};
@@ -0,0 +1,393 @@
+/*
+ * CrushCore.hpp
+ *
+ * Copyright 2013-2018 Henna Haahti
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DistrhoPlugin.hpp"
+#include "BlockNoise.hpp"
+#include "Silence.hpp"
+#include "Simd.hpp"
+#include "Smoothed.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+START_NAMESPACE_DISTRHO
+
+// Sample rate reduction with distortion and noise, on CHANNELS channels
+template <uint32_t CHANNELS>
+class CrushCore {
+public:
+    static constexpr uint32_t NUM_PARAMS = 6;
+
+    explicit CrushCore(double rate) : frame(0), holdLeft(0) {
+        for (uint32_t i = 0; i < NUM_PARAMS; ++i) {
+            Parameter p;
+            initParameter(i, p);
+            setParameterValue(i, p.ranges.def);
+        }
+        sampleRateChanged(rate);
+        activate();
+    }
+
+    static void initParameter(uint32_t index, Parameter& p) {
+        switch (index) {
+        case 0:
+            p.hints  = kParameterIsAutomatable | kParameterIsInteger;
+            p.name   = "Downsample";
+            p.symbol = "downsample";
+
+            p.ranges.min =  1.f;
+            p.ranges.max = 16.f;
+            p.ranges.def =  1.f;
+            break;
+        case 1:
+            p.hints  = kParameterIsAutomatable;
+            p.name   = "Noise Bias";
+            p.symbol = "noisebias";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 0.5f;
+            break;
+        case 2:
+            p.hints  = kParameterIsAutomatable;
+            p.name   = "Input Noise";
+            p.symbol = "prenoise";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.0f;
+            p.ranges.def = 0.f;
+            break;
+        case 3:
+            p.hints  = kParameterIsAutomatable;
+            p.name   = "Output Noise";
+            p.symbol = "postnoise";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.0f;
+            p.ranges.def = 0.f;
+            break;
+        case 4:
+            p.hints  = kParameterIsAutomatable;
+            p.name   = "Distort";
+            p.symbol = "distort";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.0f;
+            p.ranges.def = 0.f;
+            break;
+        case 5:
+            p.hints  = kParameterIsAutomatable;
+            p.name   = "Post Clip";
+            p.symbol = "postclip";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.0f;
+            p.ranges.def = 0.f;
+            break;
+        default:
+            break;
+        }
+    }
+
+    float getParameterValue(uint32_t index) const {
+        switch (index) {
+        case 0:
+            return params.downsample;
+        case 1:
+            return params.current.noisebias;
+        case 2:
+            return params.current.prenoise;
+        case 3:
+            return params.current.postnoise;
+        case 4:
+            return params.current.distort;
+        case 5:
+            return params.current.postclip;
+        default:
+            return 0.f;
+        }
+    }
+
+    void setParameterValue(uint32_t index, float value) {
+        switch (index) {
+        case 0:
+            params.downsample = value;
+            realign();
+            break;
+        case 1:
+            params.current.noisebias = value;
+            break;
+        case 2:
+            params.current.prenoise = value;
+            break;
+        case 3:
+            params.current.postnoise = value;
+            break;
+        case 4:
+            params.current.distort = value;
+            break;
+        case 5:
+            params.current.postclip = value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void activate() {
+        rng.reset();
+        std::fill(cache, cache + CHANNELS, 0.f);
+        frame = 0;
+        holdLeft = 0;
+        params.old = params.current;
+    }
+
+    void sampleRateChanged(double) {}
+
+    // Bytes held in audio buffers
+    size_t memory() const {
+        return 0;
+    }
+
+    // Stand-in for process() on a block a host leaves out, so smoothing
+    // starts from the current parameter values once processing resumes
+    void skip() {
+        params.old = params.current;
+    }
+
+    void process(const float** inputs, float** outputs, uint32_t nframes) {
+        Smoothed<float> distort(params.old.distort, params.current.distort, nframes);
+        Smoothed<float> prenoise(params.old.prenoise, params.current.prenoise, nframes);
+        Smoothed<float> postclip(params.old.postclip, params.current.postclip, nframes);
+        Smoothed<float> postnoise(params.old.postnoise, params.current.postnoise, nframes);
+        Smoothed<float> noisebias(params.old.noisebias, params.current.noisebias, nframes);
+
+        bool preConstant(distort.isConstant() && prenoise.isConstant() &&
+                         noisebias.isConstant());
+        bool postConstant(postclip.isConstant() && postnoise.isConstant() &&
+                          noisebias.isConstant());
+
+        // The post stage is the identity while both of its amounts stay at 0
+        bool post(params.old.postclip != 0.f || params.current.postclip != 0.f ||
+                  params.old.postnoise != 0.f || params.current.postnoise != 0.f);
+
+        uint32_t downsample((uint32_t) params.downsample);
+
+        // Silence in with silence held: both stages map 0 to 0, so only the
+        // hold position and the noise stream move on
+        if (isSilent(cache, CHANNELS) && isSilent<CHANNELS>(inputs, nframes)) {
+            uint32_t numHeld(holdLeft < nframes ? (nframes - holdLeft - 1) / downsample + 1 : 0);
+            holdLeft = holdLeft + numHeld * downsample - nframes;
+            frame += nframes;
+            rng.skip(CHANNELS * (numHeld + (post ? nframes : 0)));
+
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                std::fill(outputs[c], outputs[c] + nframes, 0.f);
+            }
+            params.old = params.current;
+            return;
+        }
+
+        // Work in chunks of scratch buffers padded to the vector width. All
+        // channels share the parameter setup of each chunk.
+        uint32_t heldFrame[CHUNK];
+        float amounts[3][CHUNK];
+        float noiseValue[CHANNELS][CHUNK];
+        float held[CHANNELS][CHUNK];
+        float samples[CHANNELS][CHUNK];
+
+        for (uint32_t offset = 0; offset < nframes; offset += CHUNK) {
+            uint32_t n(nframes - offset < CHUNK ? nframes - offset : CHUNK);
+
+            // Pre stage: only computed for the frames that start a new hold
+            uint32_t numHeld = 0;
+            uint32_t next = holdLeft;
+            for (; next < n; next += downsample) {
+                heldFrame[numHeld] = next;
+                for (uint32_t c = 0; c < CHANNELS; ++c) {
+                    held[c][numHeld] = inputs[c][offset + next];
+                }
+                ++numHeld;
+            }
+            holdLeft = next - n;
+
+            uint32_t padded(pad(numHeld));
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                rng.fill(noiseValue[c], numHeld);
+                for (uint32_t j = numHeld; j < padded; ++j) {
+                    noiseValue[c][j] = 0.f;
+                    held[c][j] = 0.f;
+                }
+            }
+
+            if (preConstant) {
+                clipAndNoise(held, noiseValue, padded,
+                             Uniform(distort[0]), Uniform(prenoise[0]),
+                             Uniform(noisebias[0]), 2.f);
+            } else {
+                for (uint32_t j = 0; j < padded; ++j) {
+                    uint32_t i(offset + (j < numHeld ? heldFrame[j] : 0));
+                    amounts[0][j] = distort[i];
+                    amounts[1][j] = prenoise[i];
+                    amounts[2][j] = noisebias[i];
+                }
+                clipAndNoise(held, noiseValue, padded,
+                             Varying(amounts[0]), Varying(amounts[1]),
+                             Varying(amounts[2]), 2.f);
+            }
+
+            // Hold each value until the next one comes along. Without a post
+            // stage this writes straight to the output; the inputs of this
+            // chunk have all been read at this point.
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                float* out(post ? samples[c] : outputs[c] + offset);
+                uint32_t start = 0;
+
+                for (uint32_t j = 0; j < numHeld; ++j) {
+                    std::fill(out + start, out + heldFrame[j], cache[c]);
+                    cache[c] = held[c][j];
+                    start = heldFrame[j];
+                }
+                std::fill(out + start, out + n, cache[c]);
+            }
+
+            if (!post) {
+                continue;
+            }
+
+            padded = pad(n);
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                rng.fill(noiseValue[c], n);
+                for (uint32_t f = n; f < padded; ++f) {
+                    noiseValue[c][f] = 0.f;
+                    samples[c][f] = 0.f;
+                }
+            }
+
+            if (postConstant) {
+                clipAndNoise(samples, noiseValue, padded,
+                             Uniform(postclip[0]), Uniform(postnoise[0]),
+                             Uniform(noisebias[0]), 1.f);
+            } else {
+                postclip.fill(amounts[0], offset, padded);
+                postnoise.fill(amounts[1], offset, padded);
+                noisebias.fill(amounts[2], offset, padded);
+                clipAndNoise(samples, noiseValue, padded,
+                             Varying(amounts[0]), Varying(amounts[1]),
+                             Varying(amounts[2]), 1.f);
+            }
+
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                std::memcpy(outputs[c] + offset, samples[c], sizeof(float) * n);
+            }
+        }
+
+        frame += nframes;
+        params.old = params.current;
+    }
+
+private:
+    static constexpr uint32_t CHUNK = 64;
+
+    struct SmoothedParams {
+        float noisebias;
+        float prenoise;
+        float postnoise;
+        float distort;
+        float postclip;
+    };
+
+    struct {
+        float downsample;
+        SmoothedParams current;
+        SmoothedParams old;
+    } params;
+
+    BlockNoise rng;
+
+    float cache[CHANNELS];
+
+    // Frames since activation, and frames until the next one that starts a
+    // hold. Holds start on the multiples of downsample, counted from
+    // activation, whatever the downsample was before.
+    uint32_t frame;
+    uint32_t holdLeft;
+
+    void realign() {
+        uint32_t downsample((uint32_t) params.downsample);
+        holdLeft = (downsample - frame % downsample) % downsample;
+    }
+
+
+    // Math helpers
+    // ------------
+
+    // Round up to a whole number of vectors
+    static uint32_t pad(uint32_t n) {
+        return (n + FloatVec::SIZE - 1) / FloatVec::SIZE * FloatVec::SIZE;
+    }
+
+    static FloatVec softClip(FloatVec x, FloatVec amount, FloatVec boost) {
+        FloatVec y(x * (1.f - amount));
+        return y + amount * boost * rationalTanh(x);
+    }
+
+    static FloatVec applyNoise(FloatVec x, FloatVec amount, FloatVec noise) {
+        FloatVec y(x * (1.f - amount));
+        return y + amount * (x + (x * x * noise));
+    }
+
+
+    // rational tanh approximation
+    // by cschueler
+    //
+    // http://www.musicdsp.org/showone.php?id=238
+    //
+    // The curve reaches exactly -1 and 1 at -3 and 3, so clamping the input
+    // is the same as saturating the output, minus the branches.
+    static FloatVec rationalTanh(FloatVec x) {
+        x = clamp(x, -3.f, 3.f);
+        FloatVec x2(x * x);
+        return x * (27.f + x2) / (27.f + 9.f * x2);
+    }
+
+    // Soft clip followed by noise, on every channel of a chunk
+    template <typename Source>
+    static void clipAndNoise(float (&x)[CHANNELS][CHUNK],
+                             const float (&noise)[CHANNELS][CHUNK],
+                             uint32_t padded, Source clip, Source amount, Source bias,
+                             float boost) {
+        for (uint32_t f = 0; f < padded; f += FloatVec::SIZE) {
+            FloatVec c(clip[f]);
+            FloatVec a(amount[f]);
+            FloatVec b(bias[f]);
+
+            for (uint32_t ch = 0; ch < CHANNELS; ++ch) {
+                FloatVec y(FloatVec::load(&x[ch][f]));
+                y = softClip(y, c, boost);
+                y = applyNoise(y, a, FloatVec::load(&noise[ch][f]) - b);
+                y.store(&x[ch][f]);
+            }
+        }
+    }
+};
+
+END_NAMESPACE_DISTRHO
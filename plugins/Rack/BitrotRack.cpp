@@ -0,0 +1,264 @@
+/*
+ * BitrotRack.cpp
+ *
+ * Copyright 2013-2018 Henna Haahti
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DistrhoPlugin.hpp"
+#include "Denormals.hpp"
+#include "Label.hpp"
+#include "LoadMeter.hpp"
+#include "ParameterEvents.hpp"
+#include "ToggledValue.hpp"
+#include "Version.hpp"
+
+#include "../Crush/CrushCore.hpp"
+#include "../Repeat/RepeatCore.hpp"
+#include "../Reverser/ReverserCore.hpp"
+#include "../Tapestop/TapestopCore.hpp"
+
+#include <cstring>
+
+#include "DistrhoPluginMain.cpp"
+
+
+START_NAMESPACE_DISTRHO
+
+// Crush, Repeat, Reverser and Tapestop chained in one plugin
+class BitrotRack : public Plugin, public TimedParameters {
+    static constexpr uint32_t CHANNELS = DISTRHO_PLUGIN_NUM_INPUTS;
+
+    typedef CrushCore<CHANNELS> Crush;
+    typedef RepeatCore<CHANNELS> Repeat;
+    typedef ReverserCore<CHANNELS> Reverser;
+    typedef TapestopCore<CHANNELS> Tapestop;
+
+    // The parameters of each stage follow each other in chain order. Crush
+    // has no on/off switch of its own, so the rack adds one in front.
+    static constexpr uint32_t CRUSH_ACTIVE = 0;
+    static constexpr uint32_t CRUSH_FIRST = 1;
+    static constexpr uint32_t REPEAT_FIRST = CRUSH_FIRST + Crush::NUM_PARAMS;
+    static constexpr uint32_t REVERSER_FIRST = REPEAT_FIRST + Repeat::NUM_PARAMS;
+    static constexpr uint32_t TAPESTOP_FIRST = REVERSER_FIRST + Reverser::NUM_PARAMS;
+    static constexpr uint32_t METER_FIRST = TAPESTOP_FIRST + Tapestop::NUM_PARAMS;
+    static constexpr uint32_t NUM_PARAMS = METER_FIRST + LoadMeter::NUM_PARAMS;
+
+    // Blocks go through the chain a tile at a time, small enough that a
+    // tile stays in L1 from the first stage to the last
+    static constexpr uint32_t TILE = 256;
+
+    float crushActive;
+
+    Crush crush;
+    Repeat repeat;
+    Reverser reverser;
+    Tapestop tapestop;
+
+    // A bypassed Repeat or Tapestop only rewinds its state, which needs
+    // one pass after switching off. After that the stage is skipped.
+    bool repeatIdle;
+    bool tapestopIdle;
+
+    ParameterEvents events;
+    LoadMeter meter;
+
+    static void prefix(Parameter& p, const char* name, const char* symbol) {
+        p.name = String(name) + p.name;
+        p.symbol = String(symbol) + p.symbol;
+    }
+
+public:
+    BitrotRack()
+        : Plugin(NUM_PARAMS, 0, 0),
+          crushActive(0.f),
+          crush(getSampleRate()),
+          repeat(getSampleRate()),
+          reverser(getSampleRate()),
+          tapestop(getSampleRate()),
+          repeatIdle(false),
+          tapestopIdle(false) {
+        meter.setRate(getSampleRate());
+    }
+
+    bool setParameterValueAt(uint32_t frame, uint32_t index, float value) override {
+        return events.push(frame, index, value);
+    }
+
+protected:
+    const char* getLabel() const override {
+        return LABEL("rack");
+    }
+
+    const char* getDescription() const override {
+        return "Crush, repeat, reverse and stop in a single pass";
+    }
+
+    const char* getMaker() const override {
+        return "grejppi";
+    }
+
+    const char* getLicense() const override {
+        return "Apache-2.0";
+    }
+
+    uint32_t getVersion() const override {
+        return BITROT_VERSION();
+    }
+
+    int64_t getUniqueId() const override {
+        return BITROT_UNIQUE_ID(271);
+    }
+
+    void initParameter(uint32_t index, Parameter& p) override {
+        if (index == CRUSH_ACTIVE) {
+            p.hints  = kParameterIsAutomatable | kParameterIsBoolean;
+            p.name   = "Crush Active";
+            p.symbol = "crush_active";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 0.f;
+        } else if (index < REPEAT_FIRST) {
+            Crush::initParameter(index - CRUSH_FIRST, p);
+            prefix(p, "Crush ", "crush_");
+        } else if (index < REVERSER_FIRST) {
+            Repeat::initParameter(index - REPEAT_FIRST, p);
+            prefix(p, "Repeat ", "repeat_");
+        } else if (index < TAPESTOP_FIRST) {
+            Reverser::initParameter(index - REVERSER_FIRST, p);
+            prefix(p, "Reverser ", "reverser_");
+        } else if (index < METER_FIRST) {
+            Tapestop::initParameter(index - TAPESTOP_FIRST, p);
+            prefix(p, "Tapestop ", "tapestop_");
+        } else {
+            LoadMeter::initParameter(index - METER_FIRST, p);
+        }
+    }
+
+    float getParameterValue(uint32_t index) const override {
+        if (index == CRUSH_ACTIVE) {
+            return crushActive;
+        } else if (index < REPEAT_FIRST) {
+            return crush.getParameterValue(index - CRUSH_FIRST);
+        } else if (index < REVERSER_FIRST) {
+            return repeat.getParameterValue(index - REPEAT_FIRST);
+        } else if (index < TAPESTOP_FIRST) {
+            return reverser.getParameterValue(index - REVERSER_FIRST);
+        } else if (index < METER_FIRST) {
+            return tapestop.getParameterValue(index - TAPESTOP_FIRST);
+        } else {
+            return meter.getParameterValue(index - METER_FIRST);
+        }
+    }
+
+    void setParameterValue(uint32_t index, float value) override {
+        if (index == CRUSH_ACTIVE) {
+            crushActive = value;
+        } else if (index < REPEAT_FIRST) {
+            crush.setParameterValue(index - CRUSH_FIRST, value);
+        } else if (index < REVERSER_FIRST) {
+            repeat.setParameterValue(index - REPEAT_FIRST, value);
+        } else if (index < TAPESTOP_FIRST) {
+            reverser.setParameterValue(index - REVERSER_FIRST, value);
+        } else if (index < METER_FIRST) {
+            tapestop.setParameterValue(index - TAPESTOP_FIRST, value);
+        }
+    }
+
+    void activate() override {
+        events.clear();
+        crush.activate();
+        repeat.activate();
+        reverser.activate();
+        tapestop.activate();
+        meter.setMemory(memory());
+        repeatIdle = false;
+        tapestopIdle = false;
+    }
+
+    void sampleRateChanged(double rate) override {
+        crush.sampleRateChanged(rate);
+        repeat.sampleRateChanged(rate);
+        reverser.sampleRateChanged(rate);
+        tapestop.sampleRateChanged(rate);
+        meter.setRate(rate);
+    }
+
+    size_t memory() const {
+        return crush.memory() + repeat.memory() + reverser.memory() + tapestop.memory();
+    }
+
+    // Run the chain in place on outputs, one tile at a time
+    void process(const float** inputs, float** outputs, uint32_t nframes) {
+        const float* in[CHANNELS];
+        float* out[CHANNELS];
+
+        for (uint32_t offset = 0; offset < nframes; offset += TILE) {
+            uint32_t n(nframes - offset < TILE ? nframes - offset : TILE);
+
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                out[c] = outputs[c] + offset;
+                in[c] = out[c];
+                if (outputs[c] != inputs[c]) {
+                    std::memcpy(out[c], inputs[c] + offset, sizeof(float) * n);
+                }
+            }
+
+            if (toggledValue(crushActive)) {
+                crush.process(in, out, n);
+            } else {
+                crush.skip();
+            }
+
+            bool repeatActive(toggledValue(repeat.getParameterValue(0)));
+            if (repeatActive || !repeatIdle) {
+                repeat.process(in, out, n);
+            } else {
+                repeat.skip();
+            }
+            repeatIdle = !repeatActive;
+
+            // The reverser keeps recording while bypassed, so it always runs
+            reverser.process(in, out, n);
+
+            bool tapestopActive(toggledValue(tapestop.getParameterValue(0)));
+            if (tapestopActive || !tapestopIdle) {
+                tapestop.process(in, out, n);
+            } else {
+                tapestop.skip();
+            }
+            tapestopIdle = !tapestopActive;
+        }
+    }
+
+    void run(const float** inputs, float** outputs, uint32_t nframes) override {
+        ScopedFlushDenormals flush;
+        meter.begin();
+        events.split<CHANNELS>(inputs, outputs, nframes,
+            [this](const ParameterEvent& e) {
+                setParameterValue(e.index, e.value);
+            },
+            [this](const float** in, float** out, uint32_t frames) {
+                process(in, out, frames);
+            });
+        meter.end(nframes);
+    }
+};
+
+Plugin* createPlugin() {
+    return new BitrotRack();
+}
+
+END_NAMESPACE_DISTRHO
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Channels.hpp"
+
+#define DISTRHO_PLUGIN_NAME \
+    "Bitrot Rack" BITROT_CHANNEL_NAME
+
+#define DISTRHO_PLUGIN_URI \
+    "http://grejppi.github.io/plugins/bitrot/rack" BITROT_CHANNEL_SUFFIX
+
+#define DISTRHO_PLUGIN_NUM_INPUTS      BITROT_CHANNELS
+#define DISTRHO_PLUGIN_NUM_OUTPUTS     BITROT_CHANNELS
+
+#define DISTRHO_PLUGIN_IS_RT_SAFE      1
+#define DISTRHO_PLUGIN_WANT_MIDI_INPUT 0
+
+#define DISTRHO_PLUGIN_HAS_UI          0
+#define DISTRHO_PLUGIN_WANT_NANOVG     0
@@ -1,16 +1,21 @@
 #pragma once
 
+#include "Channels.hpp"
+
 #define DISTRHO_PLUGIN_NAME \
-    "Bitrot Repeat"
+    "Bitrot Repeat" BITROT_CHANNEL_NAME
 
 #define DISTRHO_PLUGIN_URI \
-    "http://grejppi.github.io/plugins/bitrot/repeat"
+    "http://grejppi.github.io/plugins/bitrot/repeat" BITROT_CHANNEL_SUFFIX
 
+// Only the stereo build takes over from Stutter
+#if BITROT_CHANNELS == 2
 #define DISTRHO_PLUGIN_REPLACED_URI \
     "http://grejppi.github.io/plugins/bitrot/stutter"
+#endif
 
-#define DISTRHO_PLUGIN_NUM_INPUTS      2
-#define DISTRHO_PLUGIN_NUM_OUTPUTS     2
+#define DISTRHO_PLUGIN_NUM_INPUTS      BITROT_CHANNELS
+#define DISTRHO_PLUGIN_NUM_OUTPUTS     BITROT_CHANNELS
 
 #define DISTRHO_PLUGIN_IS_RT_SAFE      1
 #define DISTRHO_PLUGIN_WANT_MIDI_INPUT 0
@@ -0,0 +1,558 @@
+/*
+ * RepeatCore.hpp
+ *
+ * Copyright 2013-2018 Henna Haahti
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DistrhoPlugin.hpp"
+#include "Denormals.hpp"
+#include "Resampler.hpp"
+#include "SampleBuffer.hpp"
+#include "Smoothed.hpp"
+#include "ToggledValue.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+START_NAMESPACE_DISTRHO
+
+// Beat repeat on CHANNELS channels
+template <uint32_t CHANNELS>
+class RepeatCore {
+public:
+    static constexpr uint32_t NUM_PARAMS = 11;
+
+    explicit RepeatCore(double rate)
+        : rate(rate), writePos(0), readPos(0.0), looped(false), gain(1.f), retriggered(0) {
+        for (uint32_t i = 0; i < NUM_PARAMS; ++i) {
+            Parameter p;
+            initParameter(i, p);
+            setParameterValue(i, p.ranges.def);
+        }
+        params.old = params.current;
+        sampleRateChanged(rate);
+    }
+
+    static void initParameter(uint32_t index, Parameter& p) {
+        switch (index) {
+        case 0:
+            p.hints  = kParameterIsAutomatable | kParameterIsBoolean;
+            p.name   = "Active";
+            p.symbol = "active";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 0.f;
+            break;
+        case 1:
+            p.hints  = kParameterIsAutomatable | kParameterIsInteger;
+            p.name   = "BPM";
+            p.symbol = "bpm";
+
+            p.ranges.min =  10.f;
+            p.ranges.max = 480.f;
+            p.ranges.def = 100.f;
+            break;
+        case 2:
+            p.hints  = kParameterIsAutomatable | kParameterIsInteger;
+            p.name   = "Beats";
+            p.symbol = "beats";
+
+            p.ranges.min = 1.f;
+            p.ranges.max = 4.f;
+            p.ranges.def = 2.f;
+            break;
+        case 3:
+            p.hints  = kParameterIsAutomatable | kParameterIsInteger;
+            p.name   = "Division";
+            p.symbol = "division";
+
+            p.ranges.min =  1.f;
+            p.ranges.max = 16.f;
+            p.ranges.def =  4.f;
+            break;
+        case 4:
+            p.hints  = kParameterIsAutomatable | kParameterIsBoolean | kParameterIsTrigger;
+            p.name   = "Retrigger";
+            p.symbol = "retrigger";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 0.f;
+            break;
+        case 5:
+            p.hints  = kParameterIsAutomatable;
+            p.name   = "Attack";
+            p.symbol = "attack";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 0.f;
+            break;
+        case 6:
+            p.hints  = kParameterIsAutomatable;
+            p.name   = "Hold";
+            p.symbol = "hold";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 1.f;
+            break;
+        case 7:
+            p.hints  = kParameterIsAutomatable;
+            p.name   = "Release";
+            p.symbol = "release";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 1.f;
+            break;
+        case 8:
+            p.hints  = kParameterIsAutomatable | kParameterIsBoolean;
+            p.name   = "Varispeed";
+            p.symbol = "varispeed";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 0.f;
+            break;
+        case 9:
+            p.hints  = kParameterIsAutomatable | kParameterIsLogarithmic;
+            p.name   = "Speed";
+            p.symbol = "speed";
+
+            p.ranges.min = 0.25f;
+            p.ranges.max = 4.f;
+            p.ranges.def = 1.f;
+            break;
+        case 10:
+            p.hints  = kParameterIsAutomatable | kParameterIsInteger;
+            p.name   = "Varispeed Quality";
+            p.symbol = "quality";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 2.f;
+            p.ranges.def = 1.f;
+            break;
+        default:
+            break;
+        }
+    }
+
+    float getParameterValue(uint32_t index) const {
+        switch (index) {
+        case 0:
+            return params.active;
+        case 1:
+            return params.bpm;
+        case 2:
+            return params.beats;
+        case 3:
+            return params.division;
+        case 4:
+            return params.retrigger;
+        case 5:
+            return params.attack;
+        case 6:
+            return params.hold;
+        case 7:
+            return params.release;
+        case 8:
+            return params.varispeed;
+        case 9:
+            return params.current.speed;
+        case 10:
+            return params.quality;
+        default:
+            return 0.f;
+        }
+    }
+
+    void setParameterValue(uint32_t index, float value) {
+        switch (index) {
+            case 0:
+                params.active = value;
+                break;
+            case 1:
+                params.bpm = value;
+                bpm = (uint32_t) value;
+                updateLoop();
+                break;
+            case 2:
+                params.beats = value;
+                beats = (uint32_t) value;
+                updateLoop();
+                break;
+            case 3:
+                params.division = value;
+                division = (uint32_t) value;
+                updateLoop();
+                break;
+            case 4:
+                params.retrigger = value;
+                if (toggledValue(value) && !retriggered) {
+                    writePos = 0;
+                    readPos = 0.0;
+                    retriggered = true;
+                    looped = false;
+                } else {
+                    retriggered = false;
+                }
+                break;
+            case 5:
+                params.attack = value;
+                if (value != 0.f) {
+                    attackDelta = 1.f / (rate * (value / 10.f));
+                } else {
+                    attackDelta = 1.f;
+                }
+                break;
+            case 6:
+                params.hold = value;
+                break;
+            case 7:
+                params.release = value;
+                if (value!= 0.f) {
+                    releaseDelta = 1.f / (rate * (value/ 10.f));
+                } else {
+                    releaseDelta = 1.f;
+                }
+                break;
+            case 8:
+                params.varispeed = value;
+                break;
+            case 9:
+                params.current.speed = value;
+                break;
+            case 10:
+                // Names one of the resampler's tables whatever the host sends
+                params.quality = std::max(0.f, std::min((float) (Resampler::NUM_QUALITIES - 1),
+                                                        std::round(value)));
+                resampler = &Resampler::get((Resampler::Quality) params.quality);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // The buffers are only sized here, once the host has settled on a rate
+    void activate() {
+        writePos = 0;
+        readPos = 0.0;
+
+        for (uint32_t c = 0; c < CHANNELS; ++c) {
+            buffer[c].resize(maxTake, "repeat");
+            buffer[c].prefault();
+        }
+    }
+
+    void sampleRateChanged(double rate) {
+        maxTake = std::ceil(rate) * 24;
+        this->rate = rate;
+        updateLoop();
+
+        // The envelope speeds are given in seconds
+        setParameterValue(5, params.attack);
+        setParameterValue(7, params.release);
+    }
+
+    // Bytes held in audio buffers
+    size_t memory() const {
+        return CHANNELS * buffer[0].size() * sizeof(float);
+    }
+
+    // Stand-in for process() on a block a host leaves out, so smoothing
+    // starts from the current parameter values once processing resumes
+    void skip() {
+        params.old = params.current;
+    }
+
+    void process(const float** inputs, float** outputs, uint32_t nframes) {
+        Smoothed<float> speed(params.old.speed, params.current.speed, nframes);
+
+        if (toggledValue(params.active)) {
+            if (writePos < maxTake) {
+                for (uint32_t c = 0; c < CHANNELS; ++c) {
+                    buffer[c].write(writePos, inputs[c], std::min(nframes, maxTake - writePos));
+                }
+                writePos += nframes;
+            }
+
+            // Only [0, recorded) belongs to the current take, anything past
+            // it is stale and reads as silence. That way clearing the buffers
+            // is just a matter of rewinding writePos.
+            uint32_t recorded(std::min(writePos, maxTake));
+
+            bool varispeed(toggledValue(params.varispeed));
+            double holdPos(std::max(params.hold, 0.1f) * loopLength);
+            float speedStep(speed.delta());
+
+            uint32_t i = 0;
+            while (i < nframes) {
+                uint32_t n;
+                if (varispeed && (looped || speed[i] < 1.f)) {
+                    n = playVarispeed(outputs, i, nframes - i, recorded,
+                                      speed[i], speedStep, holdPos);
+                } else {
+                    uint32_t limit(nframes - i);
+                    if (varispeed && speedStep < 0.f) {
+                        // Switch to varispeed as soon as the speed drops below 1
+                        float left(std::floor((speed[i] - 1.f) / -speedStep) + 1.f);
+                        limit = std::min(limit, (uint32_t) left);
+                    }
+                    n = playSteady(outputs, i, limit, recorded,
+                                   speed[i], speedStep, holdPos);
+                }
+
+                if (n == 0) {
+                    playFrame(outputs, i, recorded, varispeed, speed[i], holdPos);
+                    n = 1;
+                }
+
+                i += n;
+            }
+        } else {
+            writePos = 0;
+            readPos = 0.0;
+            retriggered = 0;
+            looped = false;
+            gain = 1.f;
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                if (outputs[c] != inputs[c]) {
+                    std::memcpy(outputs[c], inputs[c], sizeof(float) * nframes);
+                }
+            }
+        }
+
+        params.old = params.current;
+    }
+
+private:
+    static constexpr uint32_t MAX_SEGMENT = 256;
+
+    // A releasing gain below this (-120 dB) is cut to zero, so quiet takes
+    // are not scaled into subnormals on the way out
+    static constexpr float SILENT = 1e-6f;
+
+    struct SmoothedParams {
+        float speed;
+    };
+
+    struct {
+        float active;
+        float bpm;
+        float beats;
+        float division;
+        float retrigger;
+        float attack;
+        float hold;
+        float release;
+        float varispeed;
+        float sync;
+        float quality;
+        SmoothedParams current;
+        SmoothedParams old;
+    } params;
+
+    // A take never wraps, it stops recording after maxTake frames
+    SampleBuffer<float> buffer[CHANNELS];
+    uint32_t maxTake;
+
+    const Resampler* resampler;
+
+    double rate;
+    double fpb;
+    uint32_t writePos;
+    double readPos;
+    double loopLength;
+    bool looped;
+
+    uint32_t bpm;
+    uint32_t beats;
+    uint32_t division;
+
+    float attackDelta;
+    float releaseDelta;
+
+    float gain;
+
+    int retriggered;
+
+    void updateLoop() {
+        fpb = (60.0 / (double) bpm) * rate;
+        loopLength = (fpb * beats) / (double) division;
+    }
+
+    // Gain after `j` envelope updates at speeds s0, s0 + ds, s0 + 2 * ds...
+    static float envelope(float g0, float delta, float s0, float ds, float j) {
+        float g(g0 + delta * (j * s0 + ds * j * (j - 1.f) * 0.5f));
+        return std::min(1.f, std::max(0.f, g));
+    }
+
+    // Playback is split into segments in which readPos neither wraps the loop
+    // nor crosses the hold point, so the envelope can be computed in closed
+    // form and the inner loops carry no branches. Each segment ends right
+    // before the frame that would cross a boundary; that frame goes through
+    // playFrame().
+
+    uint32_t playSteady(float** outputs, uint32_t offset, uint32_t limit,
+                        uint32_t recorded, float s0, float ds, double holdPos) {
+        double p0(readPos);
+        bool attack(p0 + 1.0 <= holdPos);
+
+        double wrapAt(std::min(loopLength - p0 - 1.0, (double) limit));
+        uint32_t n(wrapAt > 0.0 ? (uint32_t) std::ceil(wrapAt) : 0);
+        if (attack) {
+            n = std::min(n, (uint32_t) std::floor(std::min(holdPos - p0, (double) limit)));
+        }
+        n = std::min(n, limit);
+        if (n > MAX_SEGMENT) {
+            n = MAX_SEGMENT;
+        }
+
+        if (n == 0) {
+            return 0;
+        }
+
+        float g0(gain);
+        float delta(attack ? attackDelta : -releaseDelta);
+
+        // Released all the way, the segment is silent
+        uint32_t r0((uint32_t) p0);
+        uint32_t valid(r0 < recorded ? std::min(n, recorded - r0) : 0);
+        if (!attack && g0 == 0.f) {
+            valid = 0;
+        }
+
+        // The envelope is shared by all channels
+        float gains[MAX_SEGMENT];
+        for (uint32_t j = 0; j < valid; ++j) {
+            gains[j] = envelope(g0, delta, s0, ds, (float) j);
+        }
+
+        for (uint32_t c = 0; c < CHANNELS; ++c) {
+            const float* in(&buffer[c][r0]);
+            float* out(outputs[c] + offset);
+
+            for (uint32_t j = 0; j < valid; ++j) {
+                out[j] = in[j] * gains[j];
+            }
+            std::fill(out + valid, out + n, 0.f);
+        }
+
+        gain = envelope(g0, delta, s0, ds, (float) n);
+        if (!attack) {
+            gain = flushToZero(gain, SILENT);
+        }
+        readPos = p0 + n;
+        return n;
+    }
+
+    uint32_t playVarispeed(float** outputs, uint32_t offset, uint32_t limit,
+                           uint32_t recorded, float s0, float ds, double holdPos) {
+        double positions[MAX_SEGMENT];
+
+        double q(readPos);
+        bool attack(q + s0 <= holdPos);
+
+        if (limit > MAX_SEGMENT) {
+            limit = MAX_SEGMENT;
+        }
+
+        uint32_t n = 0;
+        while (n < limit) {
+            float s(s0 + ds * n);
+            if (!looped && s >= 1.f) {
+                break;
+            }
+
+            double next(q + s);
+            if (next >= loopLength || (next <= holdPos) != attack) {
+                break;
+            }
+
+            positions[n++] = q;
+            q = next;
+        }
+
+        if (n == 0) {
+            return 0;
+        }
+
+        float g0(gain);
+        float delta(attack ? attackDelta : -releaseDelta);
+
+        if (!attack && g0 == 0.f) {
+            // Released all the way, nothing to resample
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                std::fill(outputs[c] + offset, outputs[c] + offset + n, 0.f);
+            }
+        } else {
+            for (uint32_t j = 0; j < n; ++j) {
+                Resampler::Position p(resampler->locate(positions[j], s0 + ds * j));
+                float g(envelope(g0, delta, s0, ds, (float) j));
+
+                for (uint32_t c = 0; c < CHANNELS; ++c) {
+                    outputs[c][offset + j] = resampler->read(buffer[c].data(), recorded, p) * g;
+                }
+            }
+        }
+
+        gain = envelope(g0, delta, s0, ds, (float) n);
+        if (!attack) {
+            gain = flushToZero(gain, SILENT);
+        }
+        readPos = q;
+        return n;
+    }
+
+    void playFrame(float** outputs, uint32_t i, uint32_t recorded,
+                   bool varispeed, float speed, double holdPos) {
+        if (varispeed && (looped || speed < 1.f)) {
+            Resampler::Position p(resampler->locate(readPos, speed));
+
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                outputs[c][i] = resampler->read(buffer[c].data(), recorded, p) * gain;
+            }
+            readPos += speed;
+        } else {
+            uint32_t r((uint32_t) readPos);
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                outputs[c][i] = r < recorded ? buffer[c][r] * gain : 0.f;
+            }
+            readPos += 1.f;
+        }
+
+        while (readPos >= loopLength) {
+            readPos -= loopLength;
+            gain = 0.f;
+            looped = true;
+        }
+
+        if (readPos <= holdPos) {
+            gain += attackDelta * speed;
+            gain = std::min(gain, 1.f);
+        } else {
+            gain -= releaseDelta * speed;
+            gain = flushToZero(std::max(0.f, gain), SILENT);
+        }
+    }
+};
+
+END_NAMESPACE_DISTRHO
@@ -17,49 +17,32 @@
  */
 
 #include "DistrhoPlugin.hpp"
+#include "Denormals.hpp"
 #include "Label.hpp"
-#include "ToggledValue.hpp"
+#include "LoadMeter.hpp"
+#include "ParameterEvents.hpp"
+#include "ReverserCore.hpp"
 #include "Version.hpp"
 
-#include <cmath>
-#include <vector>
-
 #include "DistrhoPluginMain.cpp"
 
 
 START_NAMESPACE_DISTRHO
 
-class BitrotReverser : public Plugin {
-    static constexpr uint32_t NUM_PARAMS = 2;
-
-    struct {
-        float active;
-        float switchDir;
-    } params;
-
-    std::vector<float> lwork;
-    std::vector<float> rwork;
-
-    std::vector<float> lbuffer;
-    std::vector<float> rbuffer;
+class BitrotReverser : public Plugin, public TimedParameters {
+    typedef ReverserCore<DISTRHO_PLUGIN_NUM_INPUTS> Core;
 
-    int32_t writePos;
-    int32_t readPos;
-    int32_t copied;
+    Core core;
+    ParameterEvents events;
+    LoadMeter meter;
 
-    void reset() {
-        for (uint32_t i = 0; i < NUM_PARAMS; ++i) {
-            Parameter p;
-            initParameter(i, p);
-            setParameterValue(i, p.ranges.def);
-        }
+public:
+    BitrotReverser() : Plugin(Core::NUM_PARAMS + LoadMeter::NUM_PARAMS, 0, 0), core(getSampleRate()) {
+        meter.setRate(getSampleRate());
     }
 
-public:
-    BitrotReverser() : Plugin(NUM_PARAMS, 0, 0) {
-        reset();
-        sampleRateChanged(getSampleRate());
-        activate();
+    bool setParameterValueAt(uint32_t frame, uint32_t index, float value) override {
+        return events.push(frame, index, value);
     }
 
 protected:
@@ -84,108 +67,52 @@ protected:
     }
 
     int64_t getUniqueId() const override {
-        return 267;
+        return BITROT_UNIQUE_ID(267);
     }
 
     void initParameter(uint32_t index, Parameter& p) override {
-        switch (index) {
-        case 0:
-            p.hints  = kParameterIsAutomatable | kParameterIsBoolean;
-            p.name   = "Active";
-            p.symbol = "active";
-
-            p.ranges.min = 0.f;
-            p.ranges.max = 1.f;
-            p.ranges.def = 0.f;
-            break;
-        case 1:
-            p.hints  = kParameterIsAutomatable;
-            p.name   = "Switch Direction";
-            p.symbol = "switch";
-
-            p.ranges.min = 0.f;
-            p.ranges.max = 1.f;
-            p.ranges.def = 0.f;
-            break;
-        default:
-            break;
+        if (index < Core::NUM_PARAMS) {
+            Core::initParameter(index, p);
+        } else {
+            LoadMeter::initParameter(index - Core::NUM_PARAMS, p);
         }
     }
 
     float getParameterValue(uint32_t index) const override {
-        switch (index) {
-        case 0:
-            return params.active;
-        case 1:
-            return params.switchDir;
-        default:
-            return 0.f;
+        if (index < Core::NUM_PARAMS) {
+            return core.getParameterValue(index);
         }
+        return meter.getParameterValue(index - Core::NUM_PARAMS);
     }
 
     void setParameterValue(uint32_t index, float value) override {
-        switch (index) {
-        case 0:
-            params.active = value;
-            break;
-        case 1:
-            params.switchDir = value;
-            break;
-        default:
-            break;
+        if (index < Core::NUM_PARAMS) {
+            core.setParameterValue(index, value);
         }
     }
 
     void activate() override {
-        writePos = 0;
-        readPos = 0;
-        copied = -1;
+        events.clear();
+        core.activate();
+        meter.setMemory(core.memory());
     }
 
     void sampleRateChanged(double rate) override {
-        int newSize = std::ceil(rate) * 4;
-        lwork.resize(newSize, 0.f);
-        rwork.resize(newSize, 0.f);
-        lbuffer.resize(newSize, 0.f);
-        rbuffer.resize(newSize, 0.f);
+        core.sampleRateChanged(rate);
+        meter.setRate(rate);
     }
 
     void run(const float** inputs, float** outputs, uint32_t nframes) override {
-        bool playing(toggledValue(params.active));
-        int bufSize = lwork.size();
-
-        for (uint32_t i = 0; i < nframes; ++i) {
-            int w(writePos % bufSize);
-
-            lwork[w] = inputs[0][i];
-            rwork[w] = inputs[1][i];
-
-            if (playing) {
-                if (copied == -1) {
-                    for (uint32_t j = 0; j < bufSize; ++j) {
-                        lbuffer[j] = lwork[j];
-                        rbuffer[j] = rwork[j];
-                        copied = 0;
-                    }
-                } else if (copied < (bufSize >> 1)) {
-                    lbuffer[w] = lwork[w];
-                    rbuffer[w] = rwork[w];
-                    copied++;
-                }
-
-                int advance = toggledValue(params.switchDir) ? 1 : -1;
-                readPos = (readPos + advance + lbuffer.size()) % lbuffer.size();
-                outputs[0][i] = lbuffer[readPos];
-                outputs[1][i] = rbuffer[readPos];
-            } else {
-                readPos = writePos;
-                copied = -1;
-                outputs[0][i] = lwork[readPos];
-                outputs[1][i] = rwork[readPos];
-            }
-
-            writePos = (writePos + 1) % bufSize;
-        }
+        ScopedFlushDenormals flush;
+        meter.begin();
+        events.split<DISTRHO_PLUGIN_NUM_INPUTS>(inputs, outputs, nframes,
+            [this](const ParameterEvent& e) {
+                core.setParameterValue(e.index, e.value);
+            },
+            [this](const float** in, float** out, uint32_t frames) {
+                core.process(in, out, frames);
+            });
+        meter.end(nframes);
     }
 };
 
@@ -0,0 +1,349 @@
+/*
+ * ReverserCore.hpp
+ *
+ * Copyright 2013-2018 Henna Haahti
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DistrhoPlugin.hpp"
+#include "Silence.hpp"
+#include "ToggledValue.hpp"
+#include "WindowBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+START_NAMESPACE_DISTRHO
+
+// Reverse playback on CHANNELS channels
+template <uint32_t CHANNELS>
+class ReverserCore {
+public:
+    static constexpr uint32_t NUM_PARAMS = 2;
+
+    explicit ReverserCore(double rate)
+        : writePos(0), readPos(0), snapshotPos(0), elapsed(-1), silentFrames(0), snapshotSilent(false) {
+        for (uint32_t i = 0; i < NUM_PARAMS; ++i) {
+            Parameter p;
+            initParameter(i, p);
+            setParameterValue(i, p.ranges.def);
+        }
+        sampleRateChanged(rate);
+    }
+
+    static void initParameter(uint32_t index, Parameter& p) {
+        switch (index) {
+        case 0:
+            p.hints  = kParameterIsAutomatable | kParameterIsBoolean;
+            p.name   = "Active";
+            p.symbol = "active";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 0.f;
+            break;
+        case 1:
+            p.hints  = kParameterIsAutomatable;
+            p.name   = "Switch Direction";
+            p.symbol = "switch";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 0.f;
+            break;
+        default:
+            break;
+        }
+    }
+
+    float getParameterValue(uint32_t index) const {
+        switch (index) {
+        case 0:
+            return params.active;
+        case 1:
+            return params.switchDir;
+        default:
+            return 0.f;
+        }
+    }
+
+    void setParameterValue(uint32_t index, float value) {
+        switch (index) {
+        case 0:
+            params.active = value;
+            break;
+        case 1:
+            params.switchDir = value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // The buffers are only sized here, once the host has settled on a rate
+    void activate() {
+        writePos = 0;
+        readPos = 0;
+        snapshotPos = 0;
+        elapsed = -1;
+        snapshotSilent = false;
+
+        bool fresh(false);
+        for (uint32_t c = 0; c < CHANNELS; ++c) {
+            fresh |= work[c].resize(ringSize, "reverser");
+            buffer[c].resize(ringSize, "reverser");
+            work[c].prefault();
+            buffer[c].prefault();
+        }
+        if (fresh) {
+            silentFrames = ringSize;
+        }
+    }
+
+    void sampleRateChanged(double rate) {
+        ringSize = std::ceil(rate) * 4;
+    }
+
+    // Bytes held in audio buffers
+    size_t memory() const {
+        return CHANNELS * (work[0].size() + buffer[0].size()) * sizeof(float);
+    }
+
+    void process(const float** inputs, float** outputs, uint32_t nframes) {
+        // Blocks are taken at most half a buffer at a time. Playing
+        // backwards, the position captured at frame half of an engagement is
+        // read the frame before. Were both in one block, the capture would
+        // already have replaced it, so the block is split there as well.
+        int32_t bufSize(work[0].size());
+        int32_t half(bufSize >> 1);
+        int32_t start(elapsed == -1 ? 0 : elapsed);
+        uint32_t first(std::min(nframes, (uint32_t) half));
+        if (toggledValue(params.active) && start < half && start + (int32_t) first > half) {
+            first = half - start;
+        }
+        if (first < nframes) {
+            process(inputs, outputs, first);
+
+            const float* restIn[CHANNELS];
+            float* restOut[CHANNELS];
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                restIn[c] = inputs[c] + first;
+                restOut[c] = outputs[c] + first;
+            }
+            process(restIn, restOut, nframes - first);
+            return;
+        }
+
+        bool silent(isSilent<CHANNELS>(inputs, nframes));
+
+        if (!toggledValue(params.active)) {
+            capture(inputs, nframes, silent);
+            readPos = advance(writePos, -1);
+            elapsed = -1;
+
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                if (outputs[c] != inputs[c]) {
+                    std::memcpy(outputs[c], inputs[c], sizeof(float) * nframes);
+                }
+            }
+            return;
+        }
+
+        int32_t lastSave(bufSize + half);
+
+        if (elapsed == -1) {
+            snapshotPos = writePos;
+            elapsed = 0;
+            snapshotSilent = silentFrames >= (uint32_t) bufSize;
+        }
+
+        // Input captured in the first half buffer becomes part of the snapshot
+        if (!silent && elapsed <= half) {
+            snapshotSilent = false;
+        }
+
+        bool forward(toggledValue(params.switchDir));
+
+        // Nothing but silence to play back. Saving is skipped as well: a
+        // snapshot can no longer change once saving has started, so nothing
+        // saved during this engagement will be read.
+        if (snapshotSilent) {
+            capture(inputs, nframes, silent);
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                std::fill(outputs[c], outputs[c] + nframes, 0.f);
+            }
+            readPos = advance(readPos, forward ? nframes : -nframes);
+            elapsed = std::min(elapsed + (int32_t) nframes, lastSave + 1);
+            return;
+        }
+
+        // Copy on write: save what the snapshot still needs before this
+        // block's capture overwrites it
+        int32_t from(std::max(elapsed, half + 1));
+        int32_t to(std::min(elapsed + (int32_t) nframes, lastSave + 1));
+        if (from < to) {
+            save(advance(writePos, from - elapsed), to - from);
+        }
+
+        capture(inputs, nframes, silent);
+
+        int32_t savedUpTo(elapsed + (int32_t) nframes - 1);
+
+        if (savedUpTo >= lastSave) {
+            // The whole snapshot lives in the playback buffers by now
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                if (forward) {
+                    buffer[c].read(advance(readPos, 1), outputs[c], nframes);
+                } else {
+                    buffer[c].readReversed(advance(readPos, -1), outputs[c], nframes);
+                }
+            }
+            readPos = advance(readPos, forward ? nframes : -nframes);
+        } else if (forward) {
+            playSnapshot<true>(outputs, nframes, savedUpTo);
+        } else {
+            playSnapshot<false>(outputs, nframes, savedUpTo);
+        }
+
+        elapsed = std::min(savedUpTo + 1, lastSave + 1);
+    }
+
+private:
+    struct {
+        float active;
+        float switchDir;
+    } params;
+
+    // Rings of exactly ringSize frames: the length of the window is heard
+    WindowBuffer<float> work[CHANNELS];
+    WindowBuffer<float> buffer[CHANNELS];
+    uint32_t ringSize;
+
+    // Positions in the rings
+    uint32_t writePos;
+    uint32_t readPos;
+
+    // Playback reads from a snapshot of the capture ring taken when the
+    // effect is engaged. The snapshot lives in the work buffers themselves;
+    // a sample is only saved to the playback buffers right before the
+    // capture overwrites it. elapsed counts frames since engaging, -1 when
+    // idle.
+    uint32_t snapshotPos;
+    int32_t elapsed;
+
+    // Trailing frames of the capture ring known to be silent, up to its
+    // size, and whether the whole snapshot is silent
+    uint32_t silentFrames;
+    bool snapshotSilent;
+
+    // Position n frames on from pos, for n within a buffer either way
+    uint32_t advance(uint32_t pos, int32_t n) const {
+        int32_t bufSize(work[0].size());
+        int32_t p((int32_t) pos + n);
+        return p < 0 ? p + bufSize : p >= bufSize ? p - bufSize : p;
+    }
+
+    // Frames from snapshotPos on to position p
+    uint32_t sinceSnapshot(uint32_t p) const {
+        return p >= snapshotPos ? p - snapshotPos : p + work[0].size() - snapshotPos;
+    }
+
+    // Silence going into a ring that holds nothing else is not written
+    void capture(const float** inputs, uint32_t nframes, bool silent) {
+        uint32_t bufSize(work[0].size());
+        if (!silent || silentFrames < bufSize) {
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                work[c].write(writePos, inputs[c], nframes);
+            }
+        }
+        writePos = advance(writePos, nframes);
+        silentFrames = silent ? std::min(silentFrames + nframes, bufSize) : 0;
+    }
+
+    // Frame since engaging at which the capture overwrites position p of
+    // the snapshot. The half right after snapshotPos keeps following the
+    // input for half a buffer before it freezes, so it is overwritten a whole
+    // buffer later than the rest.
+    int32_t overwrittenAt(uint32_t p) const {
+        uint32_t bufSize(work[0].size());
+        uint32_t j(sinceSnapshot(p));
+        return j > (bufSize >> 1) ? j : j + bufSize;
+    }
+
+    // Number of frames, starting at position p and moving in the playback
+    // direction, that all come from the same place: the playback buffers if
+    // saved by savedUpTo, the capture ring otherwise. Every point where
+    // overwrittenAt() can cross savedUpTo ends a run.
+    template <bool Forward>
+    uint32_t runLength(uint32_t p, int32_t savedUpTo) const {
+        int32_t bufSize(work[0].size());
+        int32_t j(sinceSnapshot(p));
+        int32_t edges[] = { (bufSize >> 1) + 1, savedUpTo + 1, savedUpTo + 1 - bufSize };
+
+        if (Forward) {
+            int32_t next(bufSize);
+            for (int32_t e : edges) {
+                if (e > j && e < next) {
+                    next = e;
+                }
+            }
+            return next - j;
+        } else {
+            int32_t last(0);
+            for (int32_t e : edges) {
+                if (e <= j && e > last) {
+                    last = e;
+                }
+            }
+            return j - last + 1;
+        }
+    }
+
+    // Play back while part of the snapshot is still in the capture ring,
+    // one run of frames from the same place at a time
+    template <bool Forward>
+    void playSnapshot(float** outputs, uint32_t nframes, int32_t savedUpTo) {
+        for (uint32_t i = 0; i < nframes;) {
+            uint32_t p(advance(readPos, Forward ? 1 : -1));
+            uint32_t n(std::min(runLength<Forward>(p, savedUpTo), nframes - i));
+
+            WindowBuffer<float>* from(overwrittenAt(p) <= savedUpTo ? buffer : work);
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                if (Forward) {
+                    from[c].read(p, outputs[c] + i, n);
+                } else {
+                    from[c].readReversed(p, outputs[c] + i, n);
+                }
+            }
+
+            readPos = advance(readPos, Forward ? n : -n);
+            i += n;
+        }
+    }
+
+    // Copy [pos, pos + n) of the capture ring to the playback buffers
+    void save(uint32_t pos, uint32_t n) {
+        for (uint32_t c = 0; c < CHANNELS; ++c) {
+            typename WindowBuffer<float>::Span s(work[c].span(pos, n));
+            buffer[c].write(pos, s.first.data, s.first.size);
+            buffer[c].write(pos + s.first.size, s.second.data, s.second.size);
+        }
+    }
+};
+
+END_NAMESPACE_DISTRHO
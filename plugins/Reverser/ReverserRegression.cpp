@@ -0,0 +1,240 @@
+/*
+ * ReverserRegression.cpp
+ *
+ * Copyright 2013-2018 Henna Haahti
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Renders a few engagements through ReverserCore in blocks of awkward sizes,
+// at a few sample rates, and compares every sample with the original frame
+// by frame algorithm.
+// Prints a JSON report, and exits with failure on any difference.
+
+#include "DistrhoPlugin.hpp"
+#include "Json.hpp"
+#include "ReverserCore.hpp"
+
+#include <algorithm>
+#include <clocale>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+
+USE_NAMESPACE_DISTRHO
+
+static constexpr uint32_t CHANNELS = 2;
+
+// The original sizes its ring as 4 seconds. The first rate makes that a
+// power of two, the others do not.
+static const double rates[] = { 16384.0, 44100.0, 48000.0 };
+
+static const uint32_t blockSizes[] = { 999, 1000, 37, 1 };
+
+struct Change {
+    uint32_t frame;
+    uint32_t index;
+    float value;
+};
+
+struct Case {
+    const char* name;
+    uint32_t frames;
+    uint32_t silenceFrom;
+    uint32_t silenceTo;
+    std::vector<Change> changes;
+};
+
+
+// Reverser as it was first written: the whole capture ring is copied when
+// the effect engages, and the first half buffer of input after that is
+// copied as it comes in
+class Reference {
+public:
+    explicit Reference(double rate)
+        : work(CHANNELS, std::vector<float>(std::ceil(rate) * 4, 0.f)),
+          buffer(CHANNELS, std::vector<float>(std::ceil(rate) * 4, 0.f)),
+          writePos(0),
+          readPos(0),
+          copied(-1) {}
+
+    void process(const float** inputs, float** outputs, uint32_t nframes,
+                 bool playing, bool forward) {
+        int32_t bufSize(work[0].size());
+
+        for (uint32_t i = 0; i < nframes; ++i) {
+            int32_t w(writePos % bufSize);
+
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                work[c][w] = inputs[c][i];
+            }
+
+            if (playing) {
+                if (copied == -1) {
+                    buffer = work;
+                    copied = 0;
+                } else if (copied < (bufSize >> 1)) {
+                    for (uint32_t c = 0; c < CHANNELS; ++c) {
+                        buffer[c][w] = work[c][w];
+                    }
+                    copied++;
+                }
+
+                readPos = (readPos + (forward ? 1 : -1) + bufSize) % bufSize;
+                for (uint32_t c = 0; c < CHANNELS; ++c) {
+                    outputs[c][i] = buffer[c][readPos];
+                }
+            } else {
+                readPos = w;
+                copied = -1;
+                for (uint32_t c = 0; c < CHANNELS; ++c) {
+                    outputs[c][i] = work[c][readPos];
+                }
+            }
+
+            writePos = (writePos + 1) % bufSize;
+        }
+    }
+
+private:
+    std::vector<std::vector<float>> work;
+    std::vector<std::vector<float>> buffer;
+    int32_t writePos;
+    int32_t readPos;
+    int32_t copied;
+};
+
+
+// Frames that differ between the two renders, and the first of them
+static void render(const Case& test, double rate, uint32_t blockSize,
+                   uint32_t& mismatches, int64_t& first) {
+    ReverserCore<CHANNELS> core(rate);
+    core.activate();
+    Reference reference(rate);
+
+    std::vector<float> input(CHANNELS * test.frames);
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < test.frames; ++i) {
+        bool silent(i >= test.silenceFrom && i < test.silenceTo);
+        for (uint32_t c = 0; c < CHANNELS; ++c) {
+            seed = seed * 1664525 + 1013904223;
+            input[c * test.frames + i] = silent ? 0.f : (seed / (float) 0xffffffff) - 0.5f;
+        }
+    }
+    std::vector<float> expected(input.size());
+    std::vector<float> output(input.size());
+
+    float params[ReverserCore<CHANNELS>::NUM_PARAMS] = { 0.f, 0.f };
+    size_t next = 0;
+
+    mismatches = 0;
+    first = -1;
+
+    for (uint32_t frame = 0; frame < test.frames;) {
+        while (next < test.changes.size() && test.changes[next].frame == frame) {
+            params[test.changes[next].index] = test.changes[next].value;
+            core.setParameterValue(test.changes[next].index, test.changes[next].value);
+            ++next;
+        }
+
+        // Blocks end at parameter changes, as they do in run()
+        uint32_t n(std::min(blockSize, test.frames - frame));
+        if (next < test.changes.size()) {
+            n = std::min(n, test.changes[next].frame - frame);
+        }
+
+        const float* inputs[CHANNELS];
+        float* outputs[CHANNELS];
+        float* expecting[CHANNELS];
+        for (uint32_t c = 0; c < CHANNELS; ++c) {
+            inputs[c] = &input[c * test.frames + frame];
+            outputs[c] = &output[c * test.frames + frame];
+            expecting[c] = &expected[c * test.frames + frame];
+        }
+
+        core.process(inputs, outputs, n);
+        reference.process(inputs, expecting, n, params[0] > 0.5f, params[1] > 0.5f);
+        frame += n;
+    }
+
+    for (uint32_t i = 0; i < test.frames; ++i) {
+        bool same(true);
+        for (uint32_t c = 0; c < CHANNELS; ++c) {
+            same &= output[c * test.frames + i] == expected[c * test.frames + i];
+        }
+        if (!same) {
+            first = first == -1 ? i : first;
+            ++mismatches;
+        }
+    }
+}
+
+
+// Engagements timed against the length of the ring at the given rate
+static std::vector<Case> casesAt(double rate) {
+    uint32_t ring(std::ceil(rate) * 4);
+    uint32_t half(ring / 2);
+
+    return {
+        { "engaged from activation", 3 * ring, 0, 0,
+          { { 0, 0, 1.f } } },
+        { "engaged from bypass", 4 * ring, 0, 0,
+          { { 3 * half + 123, 0, 1.f }, { 3 * ring, 0, 0.f }, { 3 * ring + 4321, 0, 1.f } } },
+        { "forward", 3 * ring, 0, 0,
+          { { 0, 1, 1.f }, { 7777, 0, 1.f } } },
+        { "switching direction", 4 * ring, 0, 0,
+          { { ring, 0, 1.f }, { ring + half / 2, 1, 1.f }, { ring + half + 17, 1, 0.f },
+            { 2 * ring + 555, 1, 1.f }, { 3 * ring, 1, 0.f } } },
+        { "silent snapshot", 4 * ring, 0, ring + half,
+          { { ring + 100, 0, 1.f }, { ring + half + 1000, 0, 0.f }, { 3 * ring, 0, 1.f } } },
+    };
+}
+
+
+int main() {
+    std::setlocale(LC_ALL, "C");
+
+    bool failed = false;
+    Array results;
+
+    for (double rate : rates) {
+        for (const Case& test : casesAt(rate)) {
+            for (uint32_t blockSize : blockSizes) {
+                uint32_t mismatches;
+                int64_t first;
+                render(test, rate, blockSize, mismatches, first);
+                failed |= mismatches != 0;
+
+                Object result;
+                result.item("case", Syntax().string(test.name));
+                result.item("rate", Syntax().number(rate));
+                result.item("block_size", Syntax().number(blockSize));
+                result.item("frames", Syntax().number(test.frames));
+                result.item("mismatches", Syntax().number(mismatches));
+                result.item("first_mismatch", Syntax().number(first));
+                results.item(Syntax().object(result));
+            }
+        }
+    }
+
+    Object obj;
+    obj.item("plugin", Syntax().string("reverser"));
+    obj.item("results", Syntax().array(results));
+
+    Syntax().object(obj).output();
+    std::cout << std::endl;
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -17,60 +17,32 @@
  */
 
 #include "DistrhoPlugin.hpp"
+#include "Denormals.hpp"
 #include "Label.hpp"
-#include "Lerp.hpp"
-#include "ToggledValue.hpp"
+#include "LoadMeter.hpp"
+#include "ParameterEvents.hpp"
+#include "TapestopCore.hpp"
 #include "Version.hpp"
 
-#include <cmath>
-#include <vector>
-
 #include "DistrhoPluginMain.cpp"
 
 
 START_NAMESPACE_DISTRHO
 
-class BitrotTapestop : public Plugin {
-    static constexpr uint32_t NUM_PARAMS = 3;
-    static constexpr uint32_t OVERSAMPLING = 32;
-    static constexpr uint32_t BUFFER_SIZE = 192000;
-
-    struct LerpParams {
-        float fade;
-    };
-
-    struct {
-        float active;
-        float speed;
-        LerpParams current;
-        LerpParams old;
-    } params;
-
-    std::vector<float> lbuffer;
-    std::vector<float> rbuffer;
-
-    double rate;
-    double playSpeed;
-    double playSpeedFac;
-    double speed;
-
-    double readPos;
-    uint32_t writePos;
-
-    void reset() {
-        for (uint32_t i = 0; i < NUM_PARAMS; ++i) {
-            Parameter p;
-            initParameter(i, p);
-            setParameterValue(i, p.ranges.def);
-        }
-        params.old = params.current;
-    }
+class BitrotTapestop : public Plugin, public TimedParameters {
+    typedef TapestopCore<DISTRHO_PLUGIN_NUM_INPUTS> Core;
+
+    Core core;
+    ParameterEvents events;
+    LoadMeter meter;
 
 public:
-    BitrotTapestop() : Plugin(NUM_PARAMS, 0, 0) {
-        reset();
-        lbuffer.resize(BUFFER_SIZE, 0.f);
-        rbuffer.resize(BUFFER_SIZE, 0.f);
+    BitrotTapestop() : Plugin(Core::NUM_PARAMS + LoadMeter::NUM_PARAMS, 0, 0), core(getSampleRate()) {
+        meter.setRate(getSampleRate());
+    }
+
+    bool setParameterValueAt(uint32_t frame, uint32_t index, float value) override {
+        return events.push(frame, index, value);
     }
 
 protected:
@@ -95,116 +67,52 @@ protected:
     }
 
     int64_t getUniqueId() const override {
-        return 268;
+        return BITROT_UNIQUE_ID(268);
     }
 
     void initParameter(uint32_t index, Parameter& p) override {
-        switch (index) {
-        case 0:
-            p.hints  = kParameterIsAutomatable | kParameterIsBoolean;
-            p.name   = "Active";
-            p.symbol = "active";
-
-            p.ranges.min = 0.f;
-            p.ranges.max = 1.f;
-            p.ranges.def = 0.f;
-            break;
-        case 1:
-            p.hints  = kParameterIsAutomatable;
-            p.name   = "Speed";
-            p.symbol = "speed";
-
-            p.ranges.min = 0.f;
-            p.ranges.max = 1.f;
-            p.ranges.def = 0.5f;
-            break;
-        case 2:
-            p.hints  = kParameterIsAutomatable | kParameterIsBoolean;
-            p.name   = "Fade";
-            p.symbol = "fade";
-
-            p.ranges.min = 0.f;
-            p.ranges.max = 1.f;
-            p.ranges.def = 1.f;
-            break;
-        default:
-            break;
+        if (index < Core::NUM_PARAMS) {
+            Core::initParameter(index, p);
+        } else {
+            LoadMeter::initParameter(index - Core::NUM_PARAMS, p);
         }
     }
 
     float getParameterValue(uint32_t index) const override {
-        switch (index) {
-        case 0:
-            return params.active;
-        case 1:
-            return params.speed;
-        case 2:
-            return params.current.fade;
-        default:
-            return 0.f;
+        if (index < Core::NUM_PARAMS) {
+            return core.getParameterValue(index);
         }
+        return meter.getParameterValue(index - Core::NUM_PARAMS);
     }
 
     void setParameterValue(uint32_t index, float value) override {
-        switch (index) {
-            case 0:
-                params.active = value;
-                break;
-            case 1:
-                params.speed = value;
-                break;
-            case 2:
-                params.current.fade = value;
-                break;
-            default:
-                break;
+        if (index < Core::NUM_PARAMS) {
+            core.setParameterValue(index, value);
         }
     }
 
-    void run(const float** inputs, float** outputs, uint32_t nframes) override {
-        Lerp fade {
-            (float) toggledValue(params.old.fade),
-            (float) toggledValue(params.current.fade),
-            (float) nframes
-        };
-
-        if (speed != params.speed) {
-            speed = params.speed;
-            playSpeedFac = 0.9999 + ((1.0 - speed) * 0.00009);
-        }
+    void activate() override {
+        events.clear();
+        core.activate();
+        meter.setMemory(core.memory());
+    }
 
-        if (toggledValue(params.active)) {
-            for (uint32_t i = 0; i < nframes; ++i) {
-                if (writePos < BUFFER_SIZE) {
-                    lbuffer[writePos] = inputs[0][i];
-                    rbuffer[writePos] = inputs[1][i];
-                    writePos++;
-                }
-
-                float l(0.f);
-                float r(0.f);
-
-                for (uint32_t o = 0; o < OVERSAMPLING; ++o) {
-                    Lerp fadeAmount { 1.f, (float) playSpeed, 1.f };
-                    l += lbuffer[(uint32_t) readPos] * fadeAmount[fade[i]];
-                    r += rbuffer[(uint32_t) readPos] * fadeAmount[fade[i]];
-                    readPos += playSpeed / (double) OVERSAMPLING;
-                }
-
-                outputs[0][i] = l / (float) OVERSAMPLING;
-                outputs[1][i] = r / (float) OVERSAMPLING;
-
-                playSpeed *= playSpeedFac;
-            }
-        } else {
-            playSpeed = 1.f;
-            writePos = 0;
-            readPos = 0.0;
-            std::memcpy(outputs[0], inputs[0], sizeof(float) * nframes);
-            std::memcpy(outputs[1], inputs[1], sizeof(float) * nframes);
-        }
+    void sampleRateChanged(double rate) override {
+        core.sampleRateChanged(rate);
+        meter.setRate(rate);
+    }
 
-        params.old = params.current;
+    void run(const float** inputs, float** outputs, uint32_t nframes) override {
+        ScopedFlushDenormals flush;
+        meter.begin();
+        events.split<DISTRHO_PLUGIN_NUM_INPUTS>(inputs, outputs, nframes,
+            [this](const ParameterEvent& e) {
+                core.setParameterValue(e.index, e.value);
+            },
+            [this](const float** in, float** out, uint32_t frames) {
+                core.process(in, out, frames);
+            });
+        meter.end(nframes);
     }
 };
 
@@ -1,13 +1,15 @@
 #pragma once
 
+#include "Channels.hpp"
+
 #define DISTRHO_PLUGIN_NAME \
-    "Bitrot Tapestop"
+    "Bitrot Tapestop" BITROT_CHANNEL_NAME
 
 #define DISTRHO_PLUGIN_URI \
-    "http://grejppi.github.io/plugins/bitrot/tapestop"
+    "http://grejppi.github.io/plugins/bitrot/tapestop" BITROT_CHANNEL_SUFFIX
 
-#define DISTRHO_PLUGIN_NUM_INPUTS      2
-#define DISTRHO_PLUGIN_NUM_OUTPUTS     2
+#define DISTRHO_PLUGIN_NUM_INPUTS      BITROT_CHANNELS
+#define DISTRHO_PLUGIN_NUM_OUTPUTS     BITROT_CHANNELS
 
 #define DISTRHO_PLUGIN_IS_RT_SAFE      1
 #define DISTRHO_PLUGIN_WANT_MIDI_INPUT 0
@@ -0,0 +1,350 @@
+/*
+ * TapestopCore.hpp
+ *
+ * Copyright 2013-2018 Henna Haahti
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DistrhoPlugin.hpp"
+#include "Denormals.hpp"
+#include "RingBuffer.hpp"
+#include "Simd.hpp"
+#include "Smoothed.hpp"
+#include "ToggledValue.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+
+START_NAMESPACE_DISTRHO
+
+// Tape stop on CHANNELS channels
+template <uint32_t CHANNELS>
+class TapestopCore {
+public:
+    static constexpr uint32_t NUM_PARAMS = 3;
+
+    explicit TapestopCore(double rate) : playSpeed(1.0), readPos(0.0), writePos(0) {
+        for (uint32_t i = 0; i < NUM_PARAMS; ++i) {
+            Parameter p;
+            initParameter(i, p);
+            setParameterValue(i, p.ranges.def);
+        }
+        params.old = params.current;
+        sampleRateChanged(rate);
+    }
+
+    static void initParameter(uint32_t index, Parameter& p) {
+        switch (index) {
+        case 0:
+            p.hints  = kParameterIsAutomatable | kParameterIsBoolean;
+            p.name   = "Active";
+            p.symbol = "active";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 0.f;
+            break;
+        case 1:
+            p.hints  = kParameterIsAutomatable;
+            p.name   = "Speed";
+            p.symbol = "speed";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 0.5f;
+            break;
+        case 2:
+            p.hints  = kParameterIsAutomatable | kParameterIsBoolean;
+            p.name   = "Fade";
+            p.symbol = "fade";
+
+            p.ranges.min = 0.f;
+            p.ranges.max = 1.f;
+            p.ranges.def = 1.f;
+            break;
+        default:
+            break;
+        }
+    }
+
+    float getParameterValue(uint32_t index) const {
+        switch (index) {
+        case 0:
+            return params.active;
+        case 1:
+            return params.speed;
+        case 2:
+            return params.current.fade;
+        default:
+            return 0.f;
+        }
+    }
+
+    void setParameterValue(uint32_t index, float value) {
+        switch (index) {
+            case 0:
+                params.active = value;
+                break;
+            case 1:
+                params.speed = value;
+                break;
+            case 2:
+                params.current.fade = value;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // The buffers are only sized here, once the host has settled on a rate
+    void activate() {
+        playSpeed = 1.0;
+        readPos = 0.0;
+        writePos = 0;
+        updateDecay();
+
+        for (uint32_t c = 0; c < CHANNELS; ++c) {
+            buffer[c].resize(ringSize, "tapestop");
+            buffer[c].prefault();
+        }
+    }
+
+    void sampleRateChanged(double newRate) {
+        rate = newRate;
+        updateDecay();
+
+        // A stop never travels further than the sum of its speeds, which is
+        // 1 / (1 - factor) frames. The capture ring holds all of that.
+        double slowest(-std::expm1(std::log(SLOWEST_DECAY) * REFERENCE_RATE / rate));
+        ringSize = std::ceil(1.0 / slowest) + 1.0;
+    }
+
+    // Bytes held in audio buffers
+    size_t memory() const {
+        return CHANNELS * buffer[0].capacity() * sizeof(float);
+    }
+
+    // Stand-in for process() on a block a host leaves out, so smoothing
+    // starts from the current parameter values once processing resumes
+    void skip() {
+        params.old = params.current;
+    }
+
+    void process(const float** inputs, float** outputs, uint32_t nframes) {
+        Smoothed<float> fade(
+            (float) toggledValue(params.old.fade),
+            (float) toggledValue(params.current.fade),
+            nframes);
+
+        if (speed != params.speed) {
+            updateDecay();
+        }
+
+        if (toggledValue(params.active)) {
+            // Playback never gets ahead of the capture, so the whole block
+            // can be recorded up front. Capture stops short of overwriting
+            // anything playback has yet to reach.
+            uint32_t limit((uint32_t) readPos + buffer[0].capacity());
+            if (writePos < limit) {
+                uint32_t n(std::min(nframes, limit - writePos));
+                for (uint32_t c = 0; c < CHANNELS; ++c) {
+                    buffer[c].write(writePos, inputs[c], n);
+                }
+                writePos += n;
+            }
+
+            // Fully stopped, every frame reads the same sample with nothing
+            // of the next one blended in
+            if (playSpeed == 0.0) {
+                hold(outputs, nframes, fade);
+                params.old = params.current;
+                return;
+            }
+
+            // Kernels for no fade at all, a steady fade and a moving one
+            if (!fade.isConstant()) {
+                play<true, true>(outputs, nframes, fade);
+            } else if (fade[0] != 0.f) {
+                play<true, false>(outputs, nframes, fade);
+            } else {
+                play<false, false>(outputs, nframes, fade);
+            }
+        } else {
+            playSpeed = 1.f;
+            writePos = 0;
+            readPos = 0.0;
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                if (outputs[c] != inputs[c]) {
+                    std::memcpy(outputs[c], inputs[c], sizeof(float) * nframes);
+                }
+            }
+        }
+
+        params.old = params.current;
+    }
+
+private:
+    static constexpr uint32_t CHUNK = 64;
+
+    // The slowdown was tuned at 44.1 kHz: every frame the playback speed is
+    // multiplied by a factor between FASTEST_DECAY and SLOWEST_DECAY
+    static constexpr double REFERENCE_RATE = 44100.0;
+    static constexpr double FASTEST_DECAY = 0.9999;
+    static constexpr double SLOWEST_DECAY = 0.99999;
+
+    // Below this speed the rest of the stop moves the tape by less than a
+    // thousandth of a frame, so it is stopped for good before the speed can
+    // turn subnormal
+    static constexpr double STOPPED = 1e-9;
+
+    struct SmoothedParams {
+        float fade;
+    };
+
+    struct {
+        float active;
+        float speed;
+        SmoothedParams current;
+        SmoothedParams old;
+    } params;
+
+    RingBuffer<float> buffer[CHANNELS];
+    uint32_t ringSize;
+
+    double rate;
+    double playSpeed;
+    double playSpeedFac;
+    double speed;
+
+    // decay[n] is playSpeedFac^n and travel[n] the sum of its first n powers,
+    // so n frames into a chunk the speed is playSpeed * decay[n] and the
+    // read position has moved by playSpeed * travel[n]
+    double decay[CHUNK + 1];
+    double travel[CHUNK + 1];
+
+    double readPos;
+    uint32_t writePos;
+
+    // Play a block while the tape slows down. Fading is whether the output
+    // fades along with the speed, Smoothing whether the fade moves during
+    // the block.
+    template <bool Fading, bool Smoothing>
+    void play(float** outputs, uint32_t nframes, const Smoothed<float>& fade) {
+        uint32_t base[CHUNK];
+        float frac[CHUNK];
+        float speeds[CHUNK];
+        float fades[CHUNK];
+        float gain[CHUNK];
+        float crossed[CHUNK];
+        float near[CHUNK];
+        float far[CHUNK];
+
+        Uniform steadyFade(fade[0]);
+        Varying movingFade(fades);
+
+        for (uint32_t offset = 0; offset < nframes; offset += CHUNK) {
+            uint32_t n(nframes - offset < CHUNK ? nframes - offset : CHUNK);
+            uint32_t padded((n + FloatVec::SIZE - 1) / FloatVec::SIZE * FloatVec::SIZE);
+
+            // Where each frame of the chunk starts reading, and how fast
+            for (uint32_t j = 0; j < padded; ++j) {
+                uint32_t k(j < n ? j : 0);
+                double pos(readPos + playSpeed * travel[k]);
+
+                base[j] = (uint32_t) pos;
+                frac[j] = pos - base[j];
+                speeds[j] = playSpeed * decay[k];
+                if (Smoothing) {
+                    fades[j] = fade[offset + k];
+                }
+            }
+
+            // Each frame averages the captured audio over the span
+            // [pos, pos + speed). Speed never exceeds 1, so the span
+            // covers at most two neighbouring samples; crossed is the
+            // share of it past the first one.
+            for (uint32_t j = 0; j < padded; j += FloatVec::SIZE) {
+                FloatVec f(FloatVec::load(&frac[j]));
+                FloatVec sp(FloatVec::load(&speeds[j]));
+
+                (max(f + sp - FloatVec(1.f), FloatVec(0.f)) /
+                 max(sp, FloatVec(FLT_MIN))).store(&crossed[j]);
+
+                // Fade the output towards the speed as it slows down
+                if (Fading) {
+                    FloatVec amount(Smoothing ? movingFade[j] : steadyFade[j]);
+                    (FloatVec(1.f) + (sp - FloatVec(1.f)) * amount).store(&gain[j]);
+                }
+            }
+
+            for (uint32_t c = 0; c < CHANNELS; ++c) {
+                for (uint32_t j = 0; j < padded; ++j) {
+                    near[j] = buffer[c][base[j]];
+                    far[j] = buffer[c][base[j] + 1];
+                }
+
+                for (uint32_t j = 0; j < padded; j += FloatVec::SIZE) {
+                    FloatVec x0(FloatVec::load(&near[j]));
+                    FloatVec x1(FloatVec::load(&far[j]));
+                    FloatVec t(FloatVec::load(&crossed[j]));
+                    FloatVec y(x0 + (x1 - x0) * t);
+                    if (Fading) {
+                        y = y * FloatVec::load(&gain[j]);
+                    }
+                    y.store(&near[j]);
+                }
+
+                std::memcpy(outputs[c] + offset, near, sizeof(float) * n);
+            }
+
+            readPos += playSpeed * travel[n];
+            playSpeed = flushToZero(playSpeed * decay[n], STOPPED);
+        }
+    }
+
+    void hold(float** outputs, uint32_t nframes, const Smoothed<float>& fade) {
+        for (uint32_t c = 0; c < CHANNELS; ++c) {
+            float x(buffer[c][(uint32_t) readPos]);
+            if (fade.isConstant()) {
+                std::fill(outputs[c], outputs[c] + nframes, x * (1.f - fade[0]));
+            } else {
+                for (uint32_t i = 0; i < nframes; ++i) {
+                    outputs[c][i] = x * (1.f - fade[i]);
+                }
+            }
+        }
+    }
+
+    // Rebuild the tables for the current speed. Also done when activating,
+    // so the first block does not write to them for the first time.
+    void updateDecay() {
+        speed = params.speed;
+        double fac(FASTEST_DECAY + (1.0 - speed) * (SLOWEST_DECAY - FASTEST_DECAY));
+        playSpeedFac = std::pow(fac, REFERENCE_RATE / rate);
+
+        decay[0] = 1.0;
+        travel[0] = 0.0;
+        for (uint32_t n = 0; n < CHUNK; ++n) {
+            decay[n + 1] = decay[n] * playSpeedFac;
+            travel[n + 1] = travel[n] + decay[n];
+        }
+    }
+};
+
+END_NAMESPACE_DISTRHO
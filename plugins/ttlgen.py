@@ -178,6 +178,19 @@ def decimal(value):
     return ret
 
 
+# Symbols and names of the audio ports in one direction. Stereo keeps the
+# left/right ports the plugins have always had.
+def audio_ports(direction, count):
+    short = 'in' if direction == 'Input' else 'out'
+    label = 'In' if direction == 'Input' else 'Out'
+    if count == 1:
+        return [(short, label)]
+    if count == 2:
+        return [('l' + short, 'Left ' + label), ('r' + short, 'Right ' + label)]
+    return [('{0}{1}'.format(short, i + 1), '{0} {1}'.format(label, i + 1))
+            for i in range(count)]
+
+
 def write_ttl(metagen):
     metadata = subprocess.check_output(metagen)
     metadata = json.loads(metadata)
@@ -239,49 +252,28 @@ def write_ttl(metagen):
 
     plugin.predicate('rdfs:comment', string(metadata['description'], '"""'))
 
-    ports = (Object()
-        .value(Subject()
-            .predicate(
-                'a',
-                Object()
-                    .value('lv2:InputPort')
-                    .value('lv2:AudioPort'))
-            .predicate('lv2:index', integer(0))
-            .predicate('lv2:symbol', string('lin'))
-            .predicate('lv2:name', string('Left In')))
-        .value(Subject()
-            .predicate(
-                'a',
-                Object()
-                    .value('lv2:InputPort')
-                    .value('lv2:AudioPort'))
-            .predicate('lv2:index', integer(1))
-            .predicate('lv2:symbol', string('rin'))
-            .predicate('lv2:name', string('Right In')))
-        .value(Subject()
-            .predicate(
-                'a',
-                Object()
-                    .value('lv2:OutputPort')
-                    .value('lv2:AudioPort'))
-            .predicate('lv2:index', integer(2))
-            .predicate('lv2:symbol', string('lout'))
-            .predicate('lv2:name', string('Left Out')))
-        .value(Subject()
-            .predicate(
-                'a',
-                Object()
-                    .value('lv2:OutputPort')
-                    .value('lv2:AudioPort'))
-            .predicate('lv2:index', integer(3))
-            .predicate('lv2:symbol', string('rout'))
-            .predicate('lv2:name', string('Right Out'))))
-
-    index = 4
+    ports = Object()
+    index = 0
+    for direction, count in (('Input', metadata['audio_inputs']),
+                             ('Output', metadata['audio_outputs'])):
+        for symbol, name in audio_ports(direction, int(count)):
+            ports.value(Subject()
+                .predicate(
+                    'a',
+                    Object()
+                        .value('lv2:{0}Port'.format(direction))
+                        .value('lv2:AudioPort'))
+                .predicate('lv2:index', integer(index))
+                .predicate('lv2:symbol', string(symbol))
+                .predicate('lv2:name', string(name)))
+            index += 1
+
     for param in metadata['params']:
         port = Subject()
+        output = param['direction'] == 'output'
+        direction = 'lv2:OutputPort' if output else 'lv2:InputPort'
 
-        port.predicate('a', Object().value('lv2:InputPort').value('lv2:ControlPort'))
+        port.predicate('a', Object().value(direction).value('lv2:ControlPort'))
         port.predicate('lv2:index', integer(index))
         port.predicate('lv2:symbol', string(param['symbol']))
         port.predicate('lv2:name', string(param['name']))
@@ -298,7 +290,7 @@ def write_ttl(metagen):
             pprops.value('lv2:integer')
         if param['logarithmic']:
             pprops.value('pprops:logarithmic')
-        if not param['automatable']:
+        if not param['automatable'] and not output:
             pprops.value('pprops:expensive')
         if len(pprops.tokens) != 0:
             port.predicate('lv2:portProperty', pprops)